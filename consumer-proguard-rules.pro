@@ -6,4 +6,11 @@
 -keep class com.github.axet.pdfium.Pdfium$Search {*;}
 -keep class com.github.axet.pdfium.Pdfium$Bookmark {*;}
 -keep class com.github.axet.pdfium.Pdfium$Link {*;}
+-keep class com.github.axet.pdfium.Pdfium$Outline {*;}
+-keep class com.github.axet.pdfium.Pdfium$Description {*;}
+-keep class com.github.axet.pdfium.Pdfium$Cancel {*;}
+-keep class com.github.axet.pdfium.Pdfium$Avail {*;}
+-keep class com.github.axet.pdfium.Pdfium$RenderJob {*;}
+-keep class com.github.axet.pdfium.Pdfium$Index {*;}
+-keep class com.github.axet.pdfium.Pdfium$Finder {*;}
 -keep class com.github.axet.pdfium.Pdfium$PdfPasswordException {*;}
@@ -0,0 +1,148 @@
+#include "avail.hpp"
+#include "log.hpp"
+
+extern "C" {
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+}
+
+DataAvail::DataAvail(int fd, size_t length) : refs(1), fd(fd), length(length) {
+    fileAvail.version = 1;
+    fileAvail.IsDataAvail = &isDataAvail;
+    fileAvail.owner = this;
+    hints.version = 1;
+    hints.AddSegment = &addSegment;
+    hints.owner = this;
+    access.m_FileLen = length;
+    access.m_Param = this;
+    access.m_GetBlock = &getBlock;
+    avail = FPDFAvail_Create(&fileAvail, &access);
+}
+
+DataAvail::~DataAvail() {
+    if (avail != NULL)
+        FPDFAvail_Destroy(avail);
+}
+
+size_t DataAvail::getFileSize() {
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+        return 0;
+    return (size_t) st.st_size;
+}
+
+void DataAvail::addRange(size_t offset, size_t size) {
+    size_t end = offset + size;
+    std::map<size_t, size_t>::iterator it = ranges.upper_bound(offset);
+    if (it != ranges.begin()) {
+        std::map<size_t, size_t>::iterator prev = it;
+        prev--;
+        if (prev->second >= offset) { // overlaps or touches previous range
+            offset = prev->first;
+            if (prev->second > end)
+                end = prev->second;
+            ranges.erase(prev);
+        }
+    }
+    while (it != ranges.end() && it->first <= end) {
+        if (it->second > end)
+            end = it->second;
+        ranges.erase(it++);
+    }
+    ranges[offset] = end;
+}
+
+bool DataAvail::isAvail(size_t offset, size_t size) {
+    size_t end = offset + size;
+    if (end > length)
+        return false;
+    if (end <= getFileSize())
+        return true;
+    std::map<size_t, size_t>::iterator it = ranges.upper_bound(offset);
+    if (it == ranges.begin())
+        return false;
+    it--;
+    return it->second >= end;
+}
+
+int DataAvail::isDocAvail() {
+    pending.clear();
+    return FPDFAvail_IsDocAvail(avail, &hints);
+}
+
+int DataAvail::isPageAvail(int page) {
+    pending.clear();
+    return FPDFAvail_IsPageAvail(avail, page, &hints);
+}
+
+std::vector<RANGE> DataAvail::getHints() {
+    size_t fileSize = getFileSize();
+    std::vector<RANGE> result;
+    for (size_t i = 0; i < pending.size(); i++) {
+        size_t start = pending[i].first;
+        size_t end = start + pending[i].second;
+        if (end > length)
+            end = length;
+        if (start < fileSize)
+            start = fileSize;
+        // walk missing pieces of [start, end)
+        while (start < end) {
+            std::map<size_t, size_t>::iterator it = ranges.upper_bound(start);
+            if (it != ranges.begin()) {
+                std::map<size_t, size_t>::iterator prev = it;
+                prev--;
+                if (prev->second > start) {
+                    start = prev->second;
+                    continue;
+                }
+            }
+            size_t stop = it != ranges.end() && it->first < end ? it->first : end;
+            // skip parts already requested by higher priority hints
+            bool merged = false;
+            for (size_t k = 0; k < result.size() && !merged; k++) {
+                size_t rs = result[k].first;
+                size_t re = rs + result[k].second;
+                if (start >= rs && stop <= re)
+                    merged = true;
+                else if (start <= re && stop >= rs) { // overlap or touch, extend
+                    if (start < rs)
+                        rs = start;
+                    if (stop > re)
+                        re = stop;
+                    result[k] = RANGE(rs, re - rs);
+                    merged = true;
+                }
+            }
+            if (!merged)
+                result.push_back(RANGE(start, stop - start));
+            start = stop;
+        }
+    }
+    return result;
+}
+
+FPDF_BOOL DataAvail::isDataAvail(FX_FILEAVAIL *pThis, size_t offset, size_t size) {
+    return static_cast<FileAvail *>(pThis)->owner->isAvail(offset, size);
+}
+
+void DataAvail::addSegment(FX_DOWNLOADHINTS *pThis, size_t offset, size_t size) {
+    static_cast<DownloadHints *>(pThis)->owner->pending.push_back(RANGE(offset, size));
+}
+
+int DataAvail::getBlock(void *param, unsigned long position, unsigned char *outBuffer,
+                        unsigned long size) {
+    DataAvail *a = (DataAvail *) param;
+    size_t done = 0;
+    while (done < size) {
+        ssize_t r = pread(a->fd, outBuffer + done, size - done, position + done);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0) {
+            LOGE("Cannot read from file descriptor. Error:%d", errno);
+            return 0;
+        }
+        done += r;
+    }
+    return 1;
+}
@@ -0,0 +1,65 @@
+#ifndef _AVAIL_HPP_
+#define _AVAIL_HPP_
+
+#include <stddef.h>
+#include <map>
+#include <vector>
+#include <utility>
+
+#include <fpdfview.h>
+#include <fpdf_dataavail.h>
+
+typedef std::pair<size_t, size_t> RANGE; // offset, size
+
+// FPDFAvail provider for partially downloaded file. Data is available if it is inside the current file
+// size (file growing by appending) or inside ranges reported by addRange() (sparse download). Guarded by
+// sLibraryLock.
+class DataAvail {
+public:
+    DataAvail(int fd, size_t length);
+
+    ~DataAvail();
+
+    FPDF_AVAIL avail;
+    int refs; // Pdfium.Avail object plus documents opened from it
+
+    void addRange(size_t offset, size_t size);
+
+    bool isAvail(size_t offset, size_t size);
+
+    int isDocAvail();
+
+    int isPageAvail(int page);
+
+    // download hints reported by last isDocAvail() / isPageAvail() call, minus already available data.
+    // Ranges are coalesced and ordered by priority (pdfium request order)
+    std::vector<RANGE> getHints();
+
+private:
+    struct FileAvail : FX_FILEAVAIL {
+        DataAvail *owner;
+    };
+
+    struct DownloadHints : FX_DOWNLOADHINTS {
+        DataAvail *owner;
+    };
+
+    static FPDF_BOOL isDataAvail(FX_FILEAVAIL *pThis, size_t offset, size_t size);
+
+    static void addSegment(FX_DOWNLOADHINTS *pThis, size_t offset, size_t size);
+
+    static int getBlock(void *param, unsigned long position, unsigned char *outBuffer,
+                        unsigned long size);
+
+    size_t getFileSize();
+
+    int fd;
+    size_t length;
+    FileAvail fileAvail;
+    DownloadHints hints;
+    FPDF_FILEACCESS access;
+    std::map<size_t, size_t> ranges; // start -> end, non overlapping
+    std::vector<RANGE> pending;
+};
+
+#endif
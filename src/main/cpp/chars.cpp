@@ -0,0 +1,261 @@
+#include "chars.hpp"
+
+#include <math.h>
+#include <wctype.h>
+
+#include <fpdf_edit.h>
+
+CharCache::CharCache(FPDF_TEXTPAGE text, FPDF_PAGE page) {
+    if (!FPDF_GetPageBoundingBox(page, &bbox))
+        bbox.left = bbox.top = bbox.right = bbox.bottom = 0;
+    rotation = FPDFPage_GetRotation(page) & 3;
+
+    count = FPDFText_CountChars(text);
+    if (count < 0)
+        count = 0;
+    unicode.resize(count);
+    left.resize(count);
+    bottom.resize(count);
+    right.resize(count);
+    top.resize(count);
+
+    for (int i = 0; i < count; i++) {
+        unicode[i] = FPDFText_GetUnicode(text, i);
+        FS_RECTF r;
+        if (!FPDFText_GetLooseCharBox(text, i, &r)) {
+            double l, rr, b, t;
+            if (FPDFText_GetCharBox(text, i, &l, &rr, &b, &t)) {
+                r.left = l;
+                r.right = rr;
+                r.bottom = b;
+                r.top = t;
+            } else {
+                r.left = r.right = r.bottom = r.top = 0; // generated chars (line breaks) have no box
+            }
+        }
+        left[i] = r.left;
+        bottom[i] = r.bottom;
+        right[i] = r.right;
+        top[i] = r.top;
+    }
+
+    grid.build(count, left.data(), bottom.data(), right.data(), top.data(), CHARS_CELL_CHARS);
+}
+
+int CharCache::getCount() {
+    return count;
+}
+
+bool CharCache::isEmpty(int i) {
+    return right[i] <= left[i] || top[i] <= bottom[i];
+}
+
+static MATRIX matrix(float a, float b, float c, float d, float e, float f) {
+    MATRIX m = {a, b, c, d, e, f};
+    return m;
+}
+
+// apply m1 then m2
+static MATRIX concat(const MATRIX &m1, const MATRIX &m2) {
+    MATRIX m;
+    m.a = m1.a * m2.a + m1.b * m2.c;
+    m.b = m1.a * m2.b + m1.b * m2.d;
+    m.c = m1.c * m2.a + m1.d * m2.c;
+    m.d = m1.c * m2.b + m1.d * m2.d;
+    m.e = m1.e * m2.a + m1.f * m2.c + m2.e;
+    m.f = m1.e * m2.b + m1.f * m2.d + m2.f;
+    return m;
+}
+
+static MATRIX invert(const MATRIX &m) {
+    MATRIX r;
+    float det = m.a * m.d - m.b * m.c;
+    if (det == 0) {
+        r.a = r.d = 1;
+        r.b = r.c = r.e = r.f = 0;
+        return r;
+    }
+    r.a = m.d / det;
+    r.b = -m.b / det;
+    r.c = -m.c / det;
+    r.d = m.a / det;
+    r.e = (m.c * m.f - m.d * m.e) / det;
+    r.f = (m.b * m.e - m.a * m.f) / det;
+    return r;
+}
+
+static void apply(const MATRIX &m, float x, float y, float *rx, float *ry) {
+    *rx = m.a * x + m.c * y + m.e;
+    *ry = m.b * x + m.d * y + m.f;
+}
+
+// pdfium CPDF_Page::GetDisplayMatrix(): page matrix (bounding box and /Rotate) followed by viewport
+MATRIX CharCache::getMatrix(int startX, int startY, int sizeX, int sizeY, int rotate) {
+    float width = bbox.right - bbox.left;
+    float height = bbox.top - bbox.bottom;
+    MATRIX page = matrix(1, 0, 0, 1, -bbox.left, -bbox.bottom);
+    switch (rotation) {
+        case 1:
+            page = matrix(0, -1, 1, 0, -bbox.bottom, bbox.right);
+            break;
+        case 2:
+            page = matrix(-1, 0, 0, -1, bbox.right, bbox.top);
+            break;
+        case 3:
+            page = matrix(0, 1, -1, 0, bbox.top, -bbox.left);
+            break;
+    }
+    if (rotation % 2) {
+        float w = width;
+        width = height;
+        height = w;
+    }
+    if (width <= 0 || height <= 0)
+        return matrix(1, 0, 0, 1, 0, 0);
+
+    float l = startX, t = startY, r = startX + sizeX, b = startY + sizeY;
+    float x0 = l, y0 = b, x1 = l, y1 = t, x2 = r, y2 = b;
+    switch (rotate & 3) {
+        case 1:
+            x0 = l, y0 = t, x1 = r, y1 = t, x2 = l, y2 = b;
+            break;
+        case 2:
+            x0 = r, y0 = t, x1 = r, y1 = b, x2 = l, y2 = t;
+            break;
+        case 3:
+            x0 = r, y0 = b, x1 = l, y1 = b, x2 = r, y2 = t;
+            break;
+    }
+    MATRIX view = matrix((x2 - x0) / width, (y2 - y0) / width, (x1 - x0) / height,
+                         (y1 - y0) / height, x0, y0);
+    return concat(page, view);
+}
+
+static bool isWordChar(uint32_t c) {
+    return c == '_' || c == '\'' || (c > ' ' && iswalnum((wint_t) c)) ||
+           (c >= 0x80 && !iswspace((wint_t) c) && !iswpunct((wint_t) c));
+}
+
+static bool isLineBreak(uint32_t c) {
+    return c == '\r' || c == '\n';
+}
+
+bool CharCache::select(const MATRIX &m, float x1, float y1, float x2, float y2, int flags,
+                       std::vector<float> &out) {
+    MATRIX inv = invert(m);
+    float px, py;
+    apply(inv, x1, y1, &px, &py);
+    float far = (bbox.right - bbox.left) + (bbox.top - bbox.bottom); // any char
+    int a = getIndex(px, py, 1);
+    if (a == -1)
+        a = getIndex(px, py, far);
+    apply(inv, x2, y2, &px, &py);
+    int b = getIndex(px, py, 1);
+    if (b == -1)
+        b = getIndex(px, py, far);
+    if (a == -1 || b == -1)
+        return false;
+
+    int start = a < b ? a : b;
+    int end = a < b ? b : a;
+    if (flags & SELECT_LINE) {
+        while (start > 0 && !isLineBreak(unicode[start - 1]))
+            start--;
+        while (end + 1 < count && !isLineBreak(unicode[end + 1]))
+            end++;
+    } else if (flags & SELECT_WORD) {
+        if (isWordChar(unicode[start])) {
+            while (start > 0 && isWordChar(unicode[start - 1]))
+                start--;
+        }
+        if (isWordChar(unicode[end])) {
+            while (end + 1 < count && isWordChar(unicode[end + 1]))
+                end++;
+        }
+    }
+
+    out.push_back(start);
+    out.push_back(end - start + 1);
+    size_t pos = out.size();
+    int n = getLines(start, end - start + 1, out);
+    for (int i = 0; i < n; i++) { // page to device, keep left < right, top < bottom
+        float *r = &out[pos + i * 4];
+        float lx, ty, rx, by;
+        apply(m, r[0], r[1], &lx, &ty);
+        apply(m, r[2], r[3], &rx, &by);
+        r[0] = fminf(lx, rx);
+        r[1] = fminf(ty, by);
+        r[2] = fmaxf(lx, rx);
+        r[3] = fmaxf(ty, by);
+    }
+    return true;
+}
+
+int CharCache::getIndex(float x, float y, float tolerance) {
+    int x0, y0, x1, y1;
+    grid.range(x - tolerance, y - tolerance, x + tolerance, y + tolerance, &x0, &y0, &x1, &y1);
+    int best = -1;
+    float bestDistance = 0;
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            for (const int *k = grid.begin(cx, cy); k != grid.end(cx, cy); k++) {
+                int i = *k;
+                float dx = x < left[i] ? left[i] - x : x > right[i] ? x - right[i] : 0;
+                float dy = y < bottom[i] ? bottom[i] - y : y > top[i] ? y - top[i] : 0;
+                if (dx > tolerance || dy > tolerance)
+                    continue;
+                float d = dx * dx + dy * dy;
+                if (best == -1 || d < bestDistance || (d == bestDistance && i < best)) {
+                    best = i;
+                    bestDistance = d;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+int CharCache::getLines(int start, int count, std::vector<float> &out) {
+    int end = start + count;
+    if (start < 0)
+        start = 0;
+    if (count < 0 || end > this->count)
+        end = this->count;
+    int n = 0;
+    bool open = false;
+    float l = 0, t = 0, r = 0, b = 0;
+    for (int i = start; i < end; i++) {
+        if (isEmpty(i))
+            continue;
+        if (open) {
+            // same line: vertical overlap of at least half of smaller height, no jump back
+            float overlap = fminf(t, top[i]) - fmaxf(b, bottom[i]);
+            float height = fminf(t - b, top[i] - bottom[i]);
+            if (overlap >= height / 2 && left[i] >= l - height) {
+                l = fminf(l, left[i]);
+                r = fmaxf(r, right[i]);
+                t = fmaxf(t, top[i]);
+                b = fminf(b, bottom[i]);
+                continue;
+            }
+            out.push_back(l);
+            out.push_back(t);
+            out.push_back(r);
+            out.push_back(b);
+            n++;
+        }
+        l = left[i];
+        t = top[i];
+        r = right[i];
+        b = bottom[i];
+        open = true;
+    }
+    if (open) {
+        out.push_back(l);
+        out.push_back(t);
+        out.push_back(r);
+        out.push_back(b);
+        n++;
+    }
+    return n;
+}
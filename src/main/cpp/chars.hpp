@@ -0,0 +1,63 @@
+#ifndef _CHARS_HPP_
+#define _CHARS_HPP_
+
+#include <stdint.h>
+#include <vector>
+
+#include <fpdf_text.h>
+
+#include "grid.hpp"
+
+#define CHARS_CELL_CHARS 8 // average chars per grid cell
+
+#define SELECT_WORD 1 // Pdfium.SELECT_WORD
+#define SELECT_LINE 2 // Pdfium.SELECT_LINE
+
+// Affine transform: x' = a * x + c * y + e, y' = b * x + d * y + f
+typedef struct {
+    float a, b, c, d, e, f;
+} MATRIX;
+
+// Immutable snapshot of text page character boxes (page coordinates, loose boxes: full line height)
+// stored as structure of arrays, with uniform grid spatial index. Built once under sLibraryLock, then
+// queried without any lock.
+class CharCache {
+public:
+    // must be called under sLibraryLock
+    CharCache(FPDF_TEXTPAGE text, FPDF_PAGE page);
+
+    int getCount();
+
+    // page to device transform, same as FPDF_PageToDevice() for given viewport
+    MATRIX getMatrix(int startX, int startY, int sizeX, int sizeY, int rotate);
+
+    // selection between two device points (snapped to words / lines by flags), out receives start,
+    // count and line rectangles in device coordinates (left, top, right, bottom). Returns false if
+    // page has no text.
+    bool select(const MATRIX &m, float x1, float y1, float x2, float y2, int flags,
+                std::vector<float> &out);
+
+    // char under point, or nearest char which box is within tolerance. -1 if none.
+    int getIndex(float x, float y, float tolerance);
+
+    // merge boxes of char range into line rectangles, 4 floats per rect (left, top, right, bottom).
+    // Returns rect count.
+    int getLines(int start, int count, std::vector<float> &out);
+
+private:
+    bool isEmpty(int i);
+
+    int count;
+    std::vector<uint32_t> unicode;
+    std::vector<float> left;
+    std::vector<float> bottom;
+    std::vector<float> right;
+    std::vector<float> top;
+
+    SpatialGrid grid; // over char boxes
+
+    FS_RECTF bbox; // page bounding box
+    int rotation; // page /Rotate, 0..3
+};
+
+#endif
@@ -0,0 +1,255 @@
+#include "convert.hpp"
+
+#include <vector>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS
+#endif
+
+#if defined(__ANDROID__) && (defined(__arm__) || defined(__i386__) || defined(__x86_64__))
+#include <cpu-features.h>
+#endif
+
+const uint8_t BAYER[4][4] = {
+        {0,  8,  2,  10},
+        {12, 4,  14, 6},
+        {3,  11, 1,  9},
+        {15, 7,  13, 5}
+};
+
+static inline uint8_t addSat(uint8_t v, uint8_t d) {
+    int s = v + d;
+    return s > 255 ? 255 : s;
+}
+
+// scalar conversion with dither pattern shifted by column phase
+static void rowTo565At(const uint8_t *src, uint16_t *dst, int width, int phase, int y, bool dither) {
+    if (dither) {
+        const uint8_t *pattern = BAYER[y & 3];
+        for (int x = 0; x < width; x++) {
+            uint8_t d = pattern[(phase + x) & 3];
+            uint8_t R5 = addSat(src[0], d >> 1) >> 3;
+            uint8_t G6 = addSat(src[1], d >> 2) >> 2;
+            uint8_t B5 = addSat(src[2], d >> 1) >> 3;
+            dst[x] = (R5 << 11) | (G6 << 5) | B5;
+            src += 3;
+        }
+    } else {
+        for (int x = 0; x < width; x++) {
+            uint8_t R5 = (src[0] * 249 + 1014) >> 11;
+            uint8_t G6 = (src[1] * 253 + 505) >> 10;
+            uint8_t B5 = (src[2] * 249 + 1014) >> 11;
+            dst[x] = (R5 << 11) | (G6 << 5) | B5;
+            src += 3;
+        }
+    }
+}
+
+void rowTo565(const uint8_t *src, uint16_t *dst, int width, int y, bool dither) {
+    rowTo565At(src, dst, width, 0, y, dither);
+}
+
+#ifdef HAVE_X86_KERNELS
+
+// split 16 packed RGB pixels (48 bytes) into R, G, B planes
+__attribute__((target("ssse3")))
+static inline void deinterleave(const uint8_t *src, __m128i *r, __m128i *g, __m128i *b) {
+    const __m128i a0 = _mm_loadu_si128((const __m128i *) src);
+    const __m128i a1 = _mm_loadu_si128((const __m128i *) (src + 16));
+    const __m128i a2 = _mm_loadu_si128((const __m128i *) (src + 32));
+    const char z = -1;
+    *r = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(a0, _mm_setr_epi8(0, 3, 6, 9, 12, 15, z, z, z, z, z, z, z, z, z, z)),
+            _mm_shuffle_epi8(a1, _mm_setr_epi8(z, z, z, z, z, z, 2, 5, 8, 11, 14, z, z, z, z, z))),
+            _mm_shuffle_epi8(a2, _mm_setr_epi8(z, z, z, z, z, z, z, z, z, z, z, 1, 4, 7, 10, 13)));
+    *g = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(a0, _mm_setr_epi8(1, 4, 7, 10, 13, z, z, z, z, z, z, z, z, z, z, z)),
+            _mm_shuffle_epi8(a1, _mm_setr_epi8(z, z, z, z, z, 0, 3, 6, 9, 12, 15, z, z, z, z, z))),
+            _mm_shuffle_epi8(a2, _mm_setr_epi8(z, z, z, z, z, z, z, z, z, z, z, 2, 5, 8, 11, 14)));
+    *b = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(a0, _mm_setr_epi8(2, 5, 8, 11, 14, z, z, z, z, z, z, z, z, z, z, z)),
+            _mm_shuffle_epi8(a1, _mm_setr_epi8(z, z, z, z, z, 1, 4, 7, 10, 13, z, z, z, z, z, z))),
+            _mm_shuffle_epi8(a2, _mm_setr_epi8(z, z, z, z, z, z, z, z, z, z, 0, 3, 6, 9, 12, 15)));
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i thresholds(int y, int shift) {
+    const uint8_t *p = BAYER[y & 3];
+    __m128i d = _mm_set1_epi32(p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24));
+    return _mm_and_si128(_mm_srli_epi16(d, shift), _mm_set1_epi8(0xff >> shift));
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i pack565(__m128i r, __m128i g, __m128i b) {
+    return _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 11), _mm_slli_epi16(g, 5)), b);
+}
+
+// SSSE3 is part of Android x86 / x86_64 ABI, used as baseline kernel
+__attribute__((target("ssse3")))
+static void rowTo565Ssse3(const uint8_t *src, uint16_t *dst, int width, int y, bool dither) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i d5 = thresholds(y, 1);
+    const __m128i d6 = thresholds(y, 2);
+    const __m128i mul5 = _mm_set1_epi16(249), add5 = _mm_set1_epi16(1014);
+    const __m128i mul6 = _mm_set1_epi16(253), add6 = _mm_set1_epi16(505);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i r, g, b;
+        deinterleave(src + x * 3, &r, &g, &b);
+        if (dither) {
+            r = _mm_adds_epu8(r, d5);
+            g = _mm_adds_epu8(g, d6);
+            b = _mm_adds_epu8(b, d5);
+        }
+        __m128i rl = _mm_unpacklo_epi8(r, zero), rh = _mm_unpackhi_epi8(r, zero);
+        __m128i gl = _mm_unpacklo_epi8(g, zero), gh = _mm_unpackhi_epi8(g, zero);
+        __m128i bl = _mm_unpacklo_epi8(b, zero), bh = _mm_unpackhi_epi8(b, zero);
+        if (dither) {
+            rl = _mm_srli_epi16(rl, 3), rh = _mm_srli_epi16(rh, 3);
+            gl = _mm_srli_epi16(gl, 2), gh = _mm_srli_epi16(gh, 2);
+            bl = _mm_srli_epi16(bl, 3), bh = _mm_srli_epi16(bh, 3);
+        } else {
+            rl = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(rl, mul5), add5), 11);
+            rh = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(rh, mul5), add5), 11);
+            gl = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(gl, mul6), add6), 10);
+            gh = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(gh, mul6), add6), 10);
+            bl = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(bl, mul5), add5), 11);
+            bh = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(bh, mul5), add5), 11);
+        }
+        _mm_storeu_si128((__m128i *) (dst + x), pack565(rl, gl, bl));
+        _mm_storeu_si128((__m128i *) (dst + x + 8), pack565(rh, gh, bh));
+    }
+    rowTo565(src + x * 3, dst + x, width - x, y, dither); // dither pattern period divides 16
+}
+
+__attribute__((target("avx2")))
+static void rowTo565Avx2(const uint8_t *src, uint16_t *dst, int width, int y, bool dither) {
+    const __m128i d5 = thresholds(y, 1);
+    const __m128i d6 = thresholds(y, 2);
+    const __m256i mul5 = _mm256_set1_epi16(249), add5 = _mm256_set1_epi16(1014);
+    const __m256i mul6 = _mm256_set1_epi16(253), add6 = _mm256_set1_epi16(505);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i r8, g8, b8;
+        deinterleave(src + x * 3, &r8, &g8, &b8);
+        __m256i r, g, b;
+        if (dither) {
+            r = _mm256_srli_epi16(_mm256_cvtepu8_epi16(_mm_adds_epu8(r8, d5)), 3);
+            g = _mm256_srli_epi16(_mm256_cvtepu8_epi16(_mm_adds_epu8(g8, d6)), 2);
+            b = _mm256_srli_epi16(_mm256_cvtepu8_epi16(_mm_adds_epu8(b8, d5)), 3);
+        } else {
+            r = _mm256_cvtepu8_epi16(r8);
+            g = _mm256_cvtepu8_epi16(g8);
+            b = _mm256_cvtepu8_epi16(b8);
+            r = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, mul5), add5), 11);
+            g = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(g, mul6), add6), 10);
+            b = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(b, mul5), add5), 11);
+        }
+        __m256i p = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi16(r, 11), _mm256_slli_epi16(g, 5)), b);
+        _mm256_storeu_si256((__m256i *) (dst + x), p);
+    }
+    rowTo565(src + x * 3, dst + x, width - x, y, dither);
+}
+
+#endif
+
+static ROW565 selectKernel() {
+#if defined(__aarch64__)
+    return &rowTo565Neon;
+#elif defined(HAVE_NEON_KERNEL) && defined(__ANDROID__)
+    if (android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
+        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0)
+        return &rowTo565Neon;
+#elif defined(HAVE_X86_KERNELS) && defined(__ANDROID__)
+    if ((android_getCpuFeatures() & ANDROID_CPU_X86_FEATURE_AVX2) != 0)
+        return &rowTo565Avx2;
+    return &rowTo565Ssse3;
+#elif defined(HAVE_X86_KERNELS) // host build (benchmark)
+    if (__builtin_cpu_supports("avx2"))
+        return &rowTo565Avx2;
+    if (__builtin_cpu_supports("ssse3"))
+        return &rowTo565Ssse3;
+#endif
+    return &rowTo565;
+}
+
+void rgbTo565(const void *src, int srcStride, void *dst, int dstStride, int width, int height, int x, int y,
+              bool dither) {
+    static const ROW565 kernel = selectKernel();
+    // kernels are aligned to pattern column 0, convert leading pixels up to next aligned column by scalar code
+    int head = dither ? (4 - (x & 3)) & 3 : 0;
+    if (head > width)
+        head = width;
+    for (int i = 0; i < height; i++) {
+        const uint8_t *s = (const uint8_t *) src;
+        uint16_t *d = (uint16_t *) dst;
+        if (head > 0)
+            rowTo565At(s, d, head, x, y + i, dither);
+        kernel(s + head * 3, d + head, width - head, y + i, dither);
+        src = (const char *) src + srcStride;
+        dst = (char *) dst + dstStride;
+    }
+}
+
+void rgbToGray(const void *src, int srcStride, void *dst, int dstStride, int width, int height) {
+    for (int i = 0; i < height; i++) {
+        const uint8_t *s = (const uint8_t *) src;
+        uint8_t *d = (uint8_t *) dst;
+        for (int x = 0; x < width; x++, s += 3)
+            d[x] = (uint8_t) ((s[0] * 77 + s[1] * 150 + s[2] * 29) >> 8); // BT.601 luma
+        src = (const char *) src + srcStride;
+        dst = (char *) dst + dstStride;
+    }
+}
+
+void rgbTo888(const void *src, int srcStride, void *dst, int dstStride, int width, int height,
+              int bpp, bool bgr) {
+    int r = bgr ? 2 : 0;
+    int b = bgr ? 0 : 2;
+    for (int i = 0; i < height; i++) {
+        const uint8_t *s = (const uint8_t *) src;
+        uint8_t *d = (uint8_t *) dst;
+        for (int x = 0; x < width; x++, s += 3, d += bpp) {
+            d[r] = s[0];
+            d[1] = s[1];
+            d[b] = s[2];
+            if (bpp == 4)
+                d[3] = 0xFF;
+        }
+        src = (const char *) src + srcStride;
+        dst = (char *) dst + dstStride;
+    }
+}
+
+void scaleToRgb(const void *src, int srcWidth, int srcHeight, int srcStride, int srcBpp,
+                void *dst, int dstStride, int dstWidth, int dstHeight, int y, int rows) {
+    // source position of pixel centers, 16.16 fixed point, clamped to image
+    std::vector<int> xs(dstWidth);
+    for (int x = 0; x < dstWidth; x++) {
+        int64_t fx = ((int64_t) (2 * x + 1) * srcWidth << 16) / (2 * dstWidth) - 0x8000;
+        xs[x] = fx < 0 ? 0 : (int) fx;
+    }
+    for (int i = 0; i < rows; i++) {
+        int64_t fy = ((int64_t) (2 * (y + i) + 1) * srcHeight << 16) / (2 * dstHeight) - 0x8000;
+        if (fy < 0)
+            fy = 0;
+        int y0 = (int) (fy >> 16);
+        int y1 = y0 + 1 < srcHeight ? y0 + 1 : y0;
+        int wy = (int) (fy >> 8) & 0xFF;
+        const uint8_t *r0 = (const uint8_t *) src + y0 * srcStride;
+        const uint8_t *r1 = (const uint8_t *) src + y1 * srcStride;
+        uint8_t *d = (uint8_t *) dst + i * dstStride;
+        for (int x = 0; x < dstWidth; x++, d += 3) {
+            int x0 = xs[x] >> 16;
+            int x1 = x0 + 1 < srcWidth ? x0 + 1 : x0;
+            int wx = (xs[x] >> 8) & 0xFF;
+            for (int c = 0; c < 3; c++) {
+                int k = srcBpp == 1 ? 0 : 2 - c; // source is gray or B, G, R
+                int top = r0[x0 * srcBpp + k] * (256 - wx) + r0[x1 * srcBpp + k] * wx;
+                int bottom = r1[x0 * srcBpp + k] * (256 - wx) + r1[x1 * srcBpp + k] * wx;
+                d[c] = (uint8_t) ((top * (256 - wy) + bottom * wy) >> 16);
+            }
+        }
+    }
+}
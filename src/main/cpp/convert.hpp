@@ -0,0 +1,39 @@
+#ifndef _CONVERT_HPP_
+#define _CONVERT_HPP_
+
+#include <stdint.h>
+
+// 4x4 ordered dither thresholds (0..15)
+extern const uint8_t BAYER[4][4];
+
+// Row kernel: convert width pixels of RGB888 (memory order R, G, B) into RGB565. Row y selects dither
+// pattern line; dither thresholds are aligned to x = 0.
+typedef void (*ROW565)(const uint8_t *src, uint16_t *dst, int width, int y, bool dither);
+
+void rowTo565(const uint8_t *src, uint16_t *dst, int width, int y, bool dither);
+
+#if defined(__aarch64__) || defined(__ARM_ARCH_7A__)
+#define HAVE_NEON_KERNEL
+
+void rowTo565Neon(const uint8_t *src, uint16_t *dst, int width, int y, bool dither);
+
+#endif
+
+// Convert RGB888 image to RGB565 using fastest kernel for current cpu. x, y is the position of the first
+// pixel in dither pattern, so images converted by bands / tiles / clips keep continuous pattern.
+void rgbTo565(const void *src, int srcStride, void *dst, int dstStride, int width, int height, int x, int y,
+              bool dither);
+
+// Convert RGB888 image (memory order R, G, B) to 8 bit luminance.
+void rgbToGray(const void *src, int srcStride, void *dst, int dstStride, int width, int height);
+
+// Convert RGB888 image (memory order R, G, B) to BGR (bpp 3) or 4 byte opaque BGRA / RGBA (bpp 4).
+void rgbTo888(const void *src, int srcStride, void *dst, int dstStride, int width, int height,
+              int bpp, bool bgr);
+
+// Bilinear scale source image to dstWidth x dstHeight and store rows y .. y + rows - 1 of result as
+// RGB888 (memory order R, G, B). Source is gray (srcBpp 1) or B, G, R (srcBpp 3 / 4, alpha ignored).
+void scaleToRgb(const void *src, int srcWidth, int srcHeight, int srcStride, int srcBpp,
+                void *dst, int dstStride, int dstWidth, int dstHeight, int y, int rows);
+
+#endif
@@ -0,0 +1,53 @@
+#include "convert.hpp"
+
+#ifdef HAVE_NEON_KERNEL
+
+#include <arm_neon.h>
+
+static inline uint8x16_t thresholds(int y, int shift) {
+    const uint8_t *p = BAYER[y & 3];
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+    return vshlq_u8(vreinterpretq_u8_u32(vdupq_n_u32(v)), vdupq_n_s8(-shift));
+}
+
+static inline uint16x8_t pack565(uint16x8_t r, uint16x8_t g, uint16x8_t b) {
+    return vorrq_u16(vorrq_u16(vshlq_n_u16(r, 11), vshlq_n_u16(g, 5)), b);
+}
+
+static inline uint16x8_t scale(uint8x8_t v, uint8x8_t mul, uint16x8_t add, int bits) {
+    uint16x8_t w = vaddq_u16(vmull_u8(v, mul), add);
+    return bits == 5 ? vshrq_n_u16(w, 11) : vshrq_n_u16(w, 10);
+}
+
+// armeabi-v7a: compiled with -mfpu=neon, selected at runtime only when cpu reports NEON
+void rowTo565Neon(const uint8_t *src, uint16_t *dst, int width, int y, bool dither) {
+    const uint8x16_t d5 = thresholds(y, 1);
+    const uint8x16_t d6 = thresholds(y, 2);
+    const uint8x8_t mul5 = vdup_n_u8(249), mul6 = vdup_n_u8(253);
+    const uint16x8_t add5 = vdupq_n_u16(1014), add6 = vdupq_n_u16(505);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x3_t px = vld3q_u8(src + x * 3);
+        uint16x8_t rl, rh, gl, gh, bl, bh;
+        if (dither) {
+            uint8x16_t r = vshrq_n_u8(vqaddq_u8(px.val[0], d5), 3);
+            uint8x16_t g = vshrq_n_u8(vqaddq_u8(px.val[1], d6), 2);
+            uint8x16_t b = vshrq_n_u8(vqaddq_u8(px.val[2], d5), 3);
+            rl = vmovl_u8(vget_low_u8(r)), rh = vmovl_u8(vget_high_u8(r));
+            gl = vmovl_u8(vget_low_u8(g)), gh = vmovl_u8(vget_high_u8(g));
+            bl = vmovl_u8(vget_low_u8(b)), bh = vmovl_u8(vget_high_u8(b));
+        } else {
+            rl = scale(vget_low_u8(px.val[0]), mul5, add5, 5);
+            rh = scale(vget_high_u8(px.val[0]), mul5, add5, 5);
+            gl = scale(vget_low_u8(px.val[1]), mul6, add6, 6);
+            gh = scale(vget_high_u8(px.val[1]), mul6, add6, 6);
+            bl = scale(vget_low_u8(px.val[2]), mul5, add5, 5);
+            bh = scale(vget_high_u8(px.val[2]), mul5, add5, 5);
+        }
+        vst1q_u16(dst + x, pack565(rl, gl, bl));
+        vst1q_u16(dst + x + 8, pack565(rh, gh, bh));
+    }
+    rowTo565(src + x * 3, dst + x, width - x, y, dither); // dither pattern period divides 16
+}
+
+#endif
@@ -0,0 +1,91 @@
+#include "grid.hpp"
+
+#include <math.h>
+
+SpatialGrid::SpatialGrid() : minX(0), minY(0), cellW(1), cellH(1), cols(1), rows(1) {
+    cellStart.assign(2, 0);
+}
+
+void SpatialGrid::build(int count, const float *left, const float *bottom, const float *right,
+                        const float *top, int perCell) {
+    float maxX = 0, maxY = 0;
+    bool empty = true;
+    for (int i = 0; i < count; i++) {
+        if (right[i] <= left[i] || top[i] <= bottom[i])
+            continue;
+        if (empty) {
+            minX = left[i];
+            minY = bottom[i];
+            maxX = right[i];
+            maxY = top[i];
+            empty = false;
+        } else {
+            minX = fminf(minX, left[i]);
+            minY = fminf(minY, bottom[i]);
+            maxX = fmaxf(maxX, right[i]);
+            maxY = fmaxf(maxY, top[i]);
+        }
+    }
+
+    cols = rows = 1;
+    if (!empty) {
+        float w = maxX - minX;
+        float h = maxY - minY;
+        float n = (float) count / perCell;
+        if (w > 0 && h > 0) {
+            cols = (int) sqrtf(n * w / h);
+            rows = (int) sqrtf(n * h / w);
+        }
+        cols = cols < 1 ? 1 : cols > 256 ? 256 : cols;
+        rows = rows < 1 ? 1 : rows > 256 ? 256 : rows;
+        cellW = w > 0 ? w / cols : 1;
+        cellH = h > 0 ? h / rows : 1;
+    }
+
+    // counting sort of boxes into cells
+    cellStart.assign(cols * rows + 1, 0);
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            for (int c = 0; c < cols * rows; c++)
+                cellStart[c + 1] += cellStart[c];
+            cells.resize(cellStart[cols * rows]);
+        }
+        std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+        for (int i = 0; i < count; i++) {
+            if (right[i] <= left[i] || top[i] <= bottom[i])
+                continue;
+            int x0, y0, x1, y1;
+            range(left[i], bottom[i], right[i], top[i], &x0, &y0, &x1, &y1);
+            for (int y = y0; y <= y1; y++) {
+                for (int x = x0; x <= x1; x++) {
+                    int c = y * cols + x;
+                    if (pass == 0)
+                        cellStart[c + 1]++;
+                    else
+                        cells[fill[c]++] = i;
+                }
+            }
+        }
+    }
+}
+
+int SpatialGrid::cellOf(float v, float min, float size, int n) const {
+    int c = (int) floorf((v - min) / size);
+    return c < 0 ? 0 : c >= n ? n - 1 : c;
+}
+
+void SpatialGrid::range(float left, float bottom, float right, float top, int *x0, int *y0,
+                        int *x1, int *y1) const {
+    *x0 = cellOf(left, minX, cellW, cols);
+    *x1 = cellOf(right, minX, cellW, cols);
+    *y0 = cellOf(bottom, minY, cellH, rows);
+    *y1 = cellOf(top, minY, cellH, rows);
+}
+
+const int *SpatialGrid::begin(int x, int y) const {
+    return cells.data() + cellStart[y * cols + x];
+}
+
+const int *SpatialGrid::end(int x, int y) const {
+    return cells.data() + cellStart[y * cols + x + 1];
+}
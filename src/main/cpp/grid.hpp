@@ -0,0 +1,34 @@
+#ifndef _GRID_HPP_
+#define _GRID_HPP_
+
+#include <vector>
+
+// Uniform grid spatial index over axis aligned boxes (page coordinates, bottom < top). Box i is listed
+// in every cell it overlaps, empty boxes are skipped. Immutable after build, safe for concurrent reads.
+class SpatialGrid {
+public:
+    SpatialGrid();
+
+    // perCell - average boxes per cell used to size grid
+    void build(int count, const float *left, const float *bottom, const float *right,
+               const float *top, int perCell);
+
+    // cells covering rectangle, inclusive
+    void range(float left, float bottom, float right, float top, int *x0, int *y0, int *x1,
+               int *y1) const;
+
+    // boxes of cell x, y: [begin, end)
+    const int *begin(int x, int y) const;
+
+    const int *end(int x, int y) const;
+
+private:
+    int cellOf(float v, float min, float size, int n) const;
+
+    float minX, minY, cellW, cellH;
+    int cols, rows;
+    std::vector<int> cellStart; // cell c holds boxes cells[cellStart[c] .. cellStart[c + 1]]
+    std::vector<int> cells;
+};
+
+#endif
@@ -0,0 +1,305 @@
+#include "index.hpp"
+#include "log.hpp"
+
+extern "C" {
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <ctype.h>
+#include <wctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+}
+
+#include <algorithm>
+
+static bool isIdeograph(uint32_t c) {
+    return (c >= 0x3040 && c <= 0x30FF) || // Hiragana, Katakana
+           (c >= 0x3400 && c <= 0x4DBF) || // CJK Extension A
+           (c >= 0x4E00 && c <= 0x9FFF) || // CJK Unified Ideographs
+           (c >= 0xF900 && c <= 0xFAFF) || // CJK Compatibility Ideographs
+           (c >= 0x20000 && c <= 0x2FFFF); // CJK Extensions B+
+}
+
+static bool isWordChar(uint32_t c) {
+    if (c < 0x80)
+        return isalnum(c) != 0;
+    if (c <= 0xBF || c == 0xD7 || c == 0xF7) // Latin-1 punctuation and symbols
+        return false;
+    if ((c >= 0x2000 && c <= 0x2BFF) || // punctuation, symbols, arrows, box drawing
+        (c >= 0x3000 && c <= 0x303F) || // CJK punctuation
+        (c >= 0xFE30 && c <= 0xFE4F) || (c >= 0xFF00 && c <= 0xFF0F) || c == 0xFFFD)
+        return false;
+    return true;
+}
+
+static uint32_t toLower(uint32_t c) {
+    if (c < 0x80)
+        return (uint32_t) tolower(c);
+    if (c < 0x10000)
+        return (uint32_t) towlower((wint_t) c);
+    return c;
+}
+
+static void append(TERM &term, uint32_t c) {
+    if (c >= 0x10000) {
+        c -= 0x10000;
+        term.push_back((uint16_t) (0xD800 + (c >> 10)));
+        term.push_back((uint16_t) (0xDC00 + (c & 0x3FF)));
+    } else {
+        term.push_back((uint16_t) c);
+    }
+}
+
+// code points in UTF-16 string, equals FPDFText char count
+static uint32_t charCount(const uint16_t *s, uint32_t len) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        if (s[i] < 0xDC00 || s[i] > 0xDFFF)
+            n++;
+    }
+    return n;
+}
+
+void tokenize(const uint16_t *text, int len, std::vector<TERM> &words, std::vector<uint32_t> &index) {
+    TERM word;
+    uint32_t start = 0;
+    uint32_t ci = 0; // char index
+    for (int i = 0; i < len; i++, ci++) {
+        uint32_t c = text[i];
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < len && text[i + 1] >= 0xDC00 &&
+            text[i + 1] <= 0xDFFF) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (text[i + 1] - 0xDC00);
+            i++;
+        }
+        bool ideograph = isIdeograph(c);
+        if (!isWordChar(c) || ideograph) {
+            if (!word.empty()) {
+                words.push_back(word);
+                index.push_back(start);
+                word.clear();
+            }
+            if (!ideograph)
+                continue;
+            // every ideograph is a word, phrases match consecutive chars
+            append(word, c);
+            words.push_back(word);
+            index.push_back(ci);
+            word.clear();
+            continue;
+        }
+        if (word.empty())
+            start = ci;
+        append(word, toLower(c));
+    }
+    if (!word.empty()) {
+        words.push_back(word);
+        index.push_back(start);
+    }
+}
+
+IndexBuilder::IndexBuilder() : pages(0) {
+}
+
+void IndexBuilder::add(int page, const uint16_t *text, int len) {
+    std::vector<TERM> words;
+    std::vector<uint32_t> index;
+    tokenize(text, len, words, index);
+    for (size_t i = 0; i < words.size(); i++) {
+        INDEXPOSTING p;
+        p.page = page;
+        p.word = i;
+        p.index = index[i];
+        terms[words[i]].push_back(p);
+    }
+    if ((uint32_t) page + 1 > pages)
+        pages = page + 1;
+}
+
+static bool writeAll(int fd, const void *buf, size_t size) {
+    const char *p = (const char *) buf;
+    while (size > 0) {
+        ssize_t n = ::write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            LOGE("Index write failed: %s", strerror(errno));
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool IndexBuilder::write(int fd, uint64_t stamp) {
+    std::vector<INDEXTERM> table;
+    std::vector<uint16_t> chars;
+    uint32_t postings = 0;
+    for (std::map<TERM, std::vector<INDEXPOSTING> >::iterator i = terms.begin(); i != terms.end(); ++i) {
+        INDEXTERM t;
+        t.text = chars.size();
+        t.length = i->first.size();
+        t.first = postings;
+        t.count = i->second.size();
+        chars.insert(chars.end(), i->first.begin(), i->first.end());
+        postings += t.count;
+        table.push_back(t);
+    }
+    if (chars.size() % 2)
+        chars.push_back(0); // 4 byte align postings
+
+    INDEXHEADER header;
+    header.magic = INDEX_MAGIC;
+    header.version = INDEX_VERSION;
+    header.stamp = stamp;
+    header.pages = pages;
+    header.terms = table.size();
+    header.chars = chars.size();
+    header.postings = postings;
+
+    if (!writeAll(fd, &header, sizeof(header)) ||
+        !writeAll(fd, table.data(), table.size() * sizeof(INDEXTERM)) ||
+        !writeAll(fd, chars.data(), chars.size() * sizeof(uint16_t)))
+        return false;
+    for (std::map<TERM, std::vector<INDEXPOSTING> >::iterator i = terms.begin(); i != terms.end(); ++i) {
+        if (!writeAll(fd, i->second.data(), i->second.size() * sizeof(INDEXPOSTING)))
+            return false;
+    }
+    return true;
+}
+
+TextIndex::TextIndex() : map(MAP_FAILED), size(0), header(NULL), terms(NULL), chars(NULL),
+                         postings(NULL) {
+}
+
+TextIndex::~TextIndex() {
+    if (map != MAP_FAILED)
+        munmap(map, size);
+}
+
+bool TextIndex::open(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(INDEXHEADER))
+        return false;
+    size = st.st_size;
+    map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        LOGE("Index mmap failed: %s", strerror(errno));
+        return false;
+    }
+    header = (const INDEXHEADER *) map;
+    if (header->magic != INDEX_MAGIC || header->version != INDEX_VERSION)
+        return false;
+    uint64_t expected = sizeof(INDEXHEADER) + (uint64_t) header->terms * sizeof(INDEXTERM) +
+                        (uint64_t) header->chars * sizeof(uint16_t) +
+                        (uint64_t) header->postings * sizeof(INDEXPOSTING);
+    if (expected != size)
+        return false;
+    terms = (const INDEXTERM *) (header + 1);
+    chars = (const uint16_t *) (terms + header->terms);
+    postings = (const INDEXPOSTING *) (chars + header->chars);
+    for (uint32_t i = 0; i < header->terms; i++) { // corrupt offsets would read past the mapping
+        const INDEXTERM &t = terms[i];
+        if ((uint64_t) t.text + t.length > header->chars ||
+            (uint64_t) t.first + t.count > header->postings)
+            return false;
+    }
+    return true;
+}
+
+uint64_t TextIndex::getStamp() {
+    return header->stamp;
+}
+
+int TextIndex::getPageCount() {
+    return header->pages;
+}
+
+int TextIndex::lowerBound(const TERM &term) {
+    int lo = 0;
+    int hi = header->terms;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const uint16_t *s = chars + terms[mid].text;
+        if (std::lexicographical_compare(s, s + terms[mid].length, term.begin(), term.end()))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+const INDEXTERM *TextIndex::lookup(const TERM &term) {
+    int lo = lowerBound(term);
+    if (lo < (int) header->terms && terms[lo].length == term.size() &&
+        std::equal(term.begin(), term.end(), chars + terms[lo].text))
+        return &terms[lo];
+    return NULL;
+}
+
+static bool hitLess(const INDEXHIT &a, const INDEXHIT &b) {
+    return a.page < b.page || (a.page == b.page && a.word < b.word);
+}
+
+static void addHits(const INDEXPOSTING *p, uint32_t n, uint32_t count, std::vector<INDEXHIT> &hits) {
+    for (uint32_t i = 0; i < n; i++) {
+        INDEXHIT h;
+        h.page = p[i].page;
+        h.word = p[i].word;
+        h.index = p[i].index;
+        h.count = count;
+        hits.push_back(h);
+    }
+}
+
+void TextIndex::lookupPrefix(const TERM &term, std::vector<INDEXHIT> &hits) {
+    for (int lo = lowerBound(term); lo < (int) header->terms; lo++) {
+        const INDEXTERM &t = terms[lo];
+        if (t.length < term.size() || !std::equal(term.begin(), term.end(), chars + t.text))
+            break;
+        addHits(postings + t.first, t.count, charCount(chars + t.text, t.length), hits);
+    }
+    std::sort(hits.begin(), hits.end(), hitLess);
+}
+
+std::vector<INDEXHIT> TextIndex::find(const uint16_t *query, int len, int flags) {
+    std::vector<INDEXHIT> result;
+    std::vector<TERM> words;
+    std::vector<uint32_t> index;
+    tokenize(query, len, words, index);
+    if (words.empty())
+        return result;
+
+    for (size_t j = 0; j < words.size(); j++) {
+        std::vector<INDEXHIT> hits;
+        if ((flags & INDEX_PREFIX) && j == words.size() - 1) {
+            lookupPrefix(words[j], hits);
+        } else {
+            const INDEXTERM *t = lookup(words[j]);
+            if (t != NULL)
+                addHits(postings + t->first, t->count, charCount(chars + t->text, t->length), hits);
+        }
+        if (j == 0) {
+            result.swap(hits);
+            continue;
+        }
+        // keep phrases continued by word j
+        std::vector<INDEXHIT> next;
+        for (size_t i = 0; i < result.size(); i++) {
+            INDEXHIT key = result[i];
+            key.word += j;
+            std::vector<INDEXHIT>::iterator it = std::lower_bound(hits.begin(), hits.end(), key,
+                                                                  hitLess);
+            if (it != hits.end() && it->page == key.page && it->word == key.word) {
+                INDEXHIT h = result[i];
+                h.count = it->index + it->count - h.index;
+                next.push_back(h);
+            }
+        }
+        result.swap(next);
+        if (result.empty())
+            break;
+    }
+    return result;
+}
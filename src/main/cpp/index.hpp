@@ -0,0 +1,104 @@
+#ifndef _INDEX_HPP_
+#define _INDEX_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <vector>
+
+#define INDEX_MAGIC 0x49464450 // "PDFI"
+#define INDEX_VERSION 1
+
+#define INDEX_PREFIX 1 // Pdfium.INDEX_PREFIX, last query term matches as prefix
+
+// Sidecar file layout, native byte order, all sections 4 byte aligned:
+//   INDEXHEADER
+//   INDEXTERM terms[terms] sorted by term text
+//   uint16_t chars[chars] normalized term text (lower case UTF-16), padded to 4 bytes
+//   INDEXPOSTING postings[postings], grouped by term, sorted by page and word
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t stamp; // caller document identity (size / mtime), checked before use
+    uint32_t pages;
+    uint32_t terms;
+    uint32_t chars;
+    uint32_t postings;
+} INDEXHEADER;
+
+typedef struct {
+    uint32_t text; // first unit in chars
+    uint32_t length; // units
+    uint32_t first; // first posting
+    uint32_t count;
+} INDEXTERM;
+
+typedef struct {
+    uint32_t page;
+    uint32_t word; // word number on page, consecutive for phrases
+    uint32_t index; // FPDFText char index of first term char
+} INDEXPOSTING;
+
+// Query hit: page, FPDFText char index and char count of matched text
+typedef struct {
+    uint32_t page;
+    uint32_t word;
+    uint32_t index;
+    uint32_t count;
+} INDEXHIT;
+
+typedef std::vector<uint16_t> TERM;
+
+// Collects page words into in memory inverted index and writes sidecar file
+class IndexBuilder {
+public:
+    IndexBuilder();
+
+    // tokenize page text as returned by FPDFText_GetText (UTF-16, one char index per code point)
+    void add(int page, const uint16_t *text, int len);
+
+    bool write(int fd, uint64_t stamp);
+
+private:
+    std::map<TERM, std::vector<INDEXPOSTING> > terms;
+    uint32_t pages;
+};
+
+// Read only memory mapped index. Queries touch mapped pages only, no locking required.
+class TextIndex {
+public:
+    TextIndex();
+
+    ~TextIndex();
+
+    bool open(int fd);
+
+    uint64_t getStamp();
+
+    int getPageCount();
+
+    // phrase query: all query words in order on consecutive word positions
+    std::vector<INDEXHIT> find(const uint16_t *query, int len, int flags);
+
+private:
+    // first term not less than term
+    int lowerBound(const TERM &term);
+
+    const INDEXTERM *lookup(const TERM &term);
+
+    void lookupPrefix(const TERM &term, std::vector<INDEXHIT> &hits);
+
+    void *map;
+    size_t size;
+    const INDEXHEADER *header;
+    const INDEXTERM *terms;
+    const uint16_t *chars;
+    const INDEXPOSTING *postings;
+};
+
+// Split UTF-16 text into normalized words: word chars lower cased, everything else is separator.
+// index receives char index of each word first char.
+void tokenize(const uint16_t *text, int len, std::vector<TERM> &words, std::vector<uint32_t> &index);
+
+#endif
@@ -1,12 +1,26 @@
 #include "util.hpp"
+#include "tiles.hpp"
+#include "convert.hpp"
+#include "pages.hpp"
+#include "loader.hpp"
+#include "avail.hpp"
+#include "index.hpp"
+#include "chars.hpp"
+#include "links.hpp"
+#include "outline.hpp"
+#include "names.hpp"
 
 extern "C" {
 #include <unistd.h>
+#include <sched.h>
+#include <time.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
+#include <limits.h>
+#include <errno.h>
 }
 
 #include <android/bitmap.h>
@@ -17,13 +31,106 @@ using namespace android;
 #include <fpdfview.h>
 #include <fpdf_doc.h>
 #include <fpdf_text.h>
+#include <fpdf_progressive.h>
+#include <fpdf_thumbnail.h>
 #include <string>
 #include <vector>
+#include <set>
 
+// Shared / exclusive lock with scoped guards, like android::RWLock
+class RWLock {
+public:
+    RWLock() { pthread_rwlock_init(&mLock, NULL); }
+
+    ~RWLock() { pthread_rwlock_destroy(&mLock); }
+
+    class AutoRLock {
+    public:
+        AutoRLock(RWLock &lock) : mLock(lock) { pthread_rwlock_rdlock(&mLock.mLock); }
+
+        ~AutoRLock() { pthread_rwlock_unlock(&mLock.mLock); }
+
+    private:
+        RWLock &mLock;
+    };
+
+    class AutoWLock {
+    public:
+        AutoWLock(RWLock &lock) : mLock(lock) { pthread_rwlock_wrlock(&mLock.mLock); }
+
+        ~AutoWLock() { pthread_rwlock_unlock(&mLock.mLock); }
+
+    private:
+        RWLock &mLock;
+    };
+
+private:
+    pthread_rwlock_t mLock;
+};
+
+static RWLock sCacheLock; // lifetime of caches used without sLibraryLock, always taken before it
+static Mutex sDocumentLock; // DOCUMENT lifetime for readers not taking sLibraryLock, always taken after it
 static Mutex sLibraryLock; // pdfium is not threadsafe, use synchronized (https://bugs.chromium.org/p/pdfium/issues/detail?id=126)
 
 static int sLibraryReferenceCount = 0;
 
+static TileCache sTileCache(32 * 1024 * 1024); // guarded by sLibraryLock
+
+// Class refs, method and field IDs resolved once at JNI_OnLoad
+static struct {
+    jclass pdfium;
+    jfieldID pdfiumHandle;
+    jclass page;
+    jmethodID pageInit;
+    jfieldID pageHandle;
+    jfieldID pageIndex;
+    jfieldID pageOuter;
+    jfieldID pageLinks;
+    jclass text;
+    jmethodID textInit;
+    jfieldID textCache;
+    jfieldID textPage;
+    jfieldID textHandle;
+    jclass search;
+    jmethodID searchInit;
+    jfieldID searchHandle;
+    jclass textResult;
+    jmethodID textResultInit;
+    jclass bookmark;
+    jmethodID bookmarkInit;
+    jclass link;
+    jmethodID linkInit;
+    jclass outline;
+    jmethodID outlineInit;
+    jclass description;
+    jmethodID descriptionInit;
+    jclass size;
+    jmethodID sizeInit;
+    jfieldID cancelCancelled;
+    jclass rect;
+    jmethodID rectInit;
+    jclass point;
+    jmethodID pointInit;
+    jfieldID fileDescriptorDescriptor;
+    jfieldID availHandle;
+    jfieldID jobPage;
+    jfieldID jobBitmap;
+    jfieldID jobBuffer;
+    jfieldID jobWidth;
+    jfieldID jobHeight;
+    jfieldID jobStride;
+    jfieldID jobFormat;
+    jfieldID jobStartX;
+    jfieldID jobStartY;
+    jfieldID jobDrawSizeX;
+    jfieldID jobDrawSizeY;
+    jfieldID jobFlags;
+    jfieldID jobStatus;
+    jfieldID indexHandle;
+    jfieldID finderHandle;
+    jfieldID finderOuter;
+} sJni;
+
 static void initLibraryIfNeed() {
     if (sLibraryReferenceCount == 0) {
         LOGD("Init FPDF library");
@@ -58,26 +165,15 @@ inline long getFileSize(int fd) {
 }
 
 int getFD(JNIEnv *env, jobject pfd) {
-    jclass cls = env->GetObjectClass(pfd);
-    jfieldID fid = env->GetFieldID(cls, "descriptor", "I");
-    return env->GetIntField(pfd, fid);
+    return env->GetIntField(pfd, sJni.fileDescriptorDescriptor);
 }
 
+// Android is little endian, jchar strings are UTF-16LE already
 FPDF_WIDESTRING GetStringUTF16LEChars(JNIEnv *env, jstring str) {
-    jclass stringCls = env->GetObjectClass(str);
-    jmethodID stringGetBytes = env->GetMethodID(stringCls, "getBytes", "(Ljava/lang/String;)[B");
-    const jstring charsetName = env->NewStringUTF("UTF-16LE");
-    const jbyteArray stringBytes = (jbyteArray) env->CallObjectMethod(str, stringGetBytes,
-                                                                      charsetName);
-    env->DeleteLocalRef(charsetName);
-    jsize length = env->GetArrayLength(stringBytes);
-    jbyte *s = env->GetByteArrayElements(stringBytes, NULL);
-    jbyte *ss = (jbyte *) malloc(length + 2);
+    jsize length = env->GetStringLength(str);
+    jchar *ss = (jchar *) malloc((length + 1) * sizeof(jchar));
+    env->GetStringRegion(str, 0, length, ss);
     ss[length] = 0;
-    ss[length + 1] = 0;
-    memcpy((void *) ss, s, length);
-    env->ReleaseByteArrayElements(stringBytes, s, JNI_ABORT);
-    env->DeleteLocalRef(stringBytes);
     return (FPDF_WIDESTRING) ss;
 }
 
@@ -86,16 +182,7 @@ void ReleaseStringUTF16LEChars(FPDF_WIDESTRING ss) {
 }
 
 jstring NewStringUTF16LE(JNIEnv *env, const jbyte *buf, int len) {
-    jclass stringCls = env->FindClass("java/lang/String");
-    jmethodID constructorID = env->GetMethodID(stringCls, "<init>", "([BLjava/lang/String;)V");
-    const jstring charsetName = env->NewStringUTF("UTF-16LE");
-    jbyteArray ba = env->NewByteArray(len);
-    env->SetByteArrayRegion(ba, 0, len, buf);
-    const jstring str = (jstring) env->NewObject(stringCls, constructorID, ba, charsetName);
-    env->DeleteLocalRef(charsetName);
-    env->DeleteLocalRef(ba);
-    env->DeleteLocalRef(stringCls);
-    return str;
+    return env->NewString((const jchar *) buf, len / sizeof(jchar));
 }
 
 static char *getErrorDescription(const long error) {
@@ -150,44 +237,552 @@ int jniThrowExceptionFmt(JNIEnv *env, const char *className, const char *fmt, ..
     va_end(args);
 }
 
-uint16_t rgb_to_565(unsigned char R8, unsigned char G8, unsigned char B8) {
-    unsigned char R5 = (R8 * 249 + 1014) >> 11;
-    unsigned char G6 = (G8 * 253 + 505) >> 10;
-    unsigned char B5 = (B8 * 249 + 1014) >> 11;
-    return (R5 << 11) | (G6 << 5) | (B5);
+#define RENDER_DITHER 0x01000000 // Pdfium.RENDER_DITHER, ordered dither for RGB_565 output
+
+#define OPEN_MMAP 1 // Pdfium.OPEN_MMAP
+#define OPEN_CACHE 2 // Pdfium.OPEN_CACHE
+
+#define CACHE_SIZE (1024 * 1024) // default block cache budget
+
+#define FORMAT_GRAY 1 // Pdfium.FORMAT_GRAY, 8 bit luminance
+#define FORMAT_BGR 2 // Pdfium.FORMAT_BGR
+#define FORMAT_BGRA 4 // Pdfium.FORMAT_BGRA
+#define FORMAT_RGBA 5 // Pdfium.FORMAT_RGBA, android ARGB_8888 memory layout
+#define FORMAT_RGB_565 6 // Pdfium.FORMAT_RGB_565
+
+#define BAND_SIZE (512 * 1024) // RGB_565 / gray rendering strip buffer size in bytes
+#define BAND_ROWS 256 // minimum band height, bounds band count (render passes) for wide targets
+
+static void *sBand = NULL; // RGB_565 / gray rendering strip buffer, guarded by sLibraryLock
+static size_t sBandSize = 0;
+
+typedef struct {
+    AndroidBitmapInfo info; // width, height and stride of target pixels
+    int format; // FORMAT_*
+    void *addr; // locked android bitmap pixels or caller buffer
+    void *tmp; // BGR buffer used to render RGB_565 bitmaps progressively, NULL otherwise
+    bool dither;
+} BITMAP;
+
+int bytesPerPixel(int format) {
+    switch (format) {
+        case FORMAT_GRAY:
+            return 1;
+        case FORMAT_BGR:
+            return 3;
+        case FORMAT_BGRA:
+        case FORMAT_RGBA:
+            return 4;
+        case FORMAT_RGB_565:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+bool lockBitmap(JNIEnv *env, jobject bitmap, BITMAP *bm, int flags) {
+    int ret;
+    if ((ret = AndroidBitmap_getInfo(env, bitmap, &bm->info)) < 0) {
+        LOGE("Fetching bitmap info failed: %s", strerror(ret * -1));
+        return false;
+    }
+
+    if (bm->info.format != ANDROID_BITMAP_FORMAT_RGBA_8888 &&
+        bm->info.format != ANDROID_BITMAP_FORMAT_RGB_565) {
+        LOGE("Bitmap format must be RGBA_8888 or RGB_565");
+        return false;
+    }
+
+    if ((ret = AndroidBitmap_lockPixels(env, bitmap, &bm->addr)) != 0) {
+        LOGE("Locking bitmap failed: %s", strerror(ret * -1));
+        return false;
+    }
+
+    bm->format = bm->info.format == ANDROID_BITMAP_FORMAT_RGB_565 ? FORMAT_RGB_565 : FORMAT_RGBA;
+    bm->tmp = NULL;
+    bm->dither = (flags & RENDER_DITHER) != 0;
+
+    return true;
+}
+
+// fill canvas background, top is vertical offset of pdfBitmap within canvas (band position)
+void fillBackground(FPDF_BITMAP pdfBitmap, int canvasHorSize, int canvasVerSize, int top,
+                    int startX, int startY, int drawSizeHor, int drawSizeVer, bool white) {
+    if (drawSizeHor < canvasHorSize || drawSizeVer < canvasVerSize) {
+        FPDFBitmap_FillRect(pdfBitmap, 0, -top, canvasHorSize, canvasVerSize, 0x848484FF); // Gray
+    }
+
+    int baseHorSize = (canvasHorSize < drawSizeHor) ? canvasHorSize : (int) drawSizeHor;
+    int baseVerSize = (canvasVerSize < drawSizeVer) ? canvasVerSize : (int) drawSizeVer;
+    int baseX = (startX < 0) ? 0 : (int) startX;
+    int baseY = (startY < 0) ? 0 : (int) startY;
+
+    if (white) {
+        FPDFBitmap_FillRect(pdfBitmap, baseX, baseY - top, baseHorSize, baseVerSize, 0xFFFFFFFF); // White
+    }
+}
+
+// Whole target pdfium bitmap with background filled, NULL if out of memory
+FPDF_BITMAP createBitmap(BITMAP *bm, int startX, int startY, int drawSizeHor, int drawSizeVer) {
+    int canvasHorSize = bm->info.width;
+    int canvasVerSize = bm->info.height;
+
+    FPDF_BITMAP pdfBitmap;
+    if (bm->format == FORMAT_RGB_565) {
+        bm->tmp = malloc((size_t) canvasVerSize * canvasHorSize * sizeof(rgb));
+        if (bm->tmp == NULL) {
+            LOGE("Unable to allocate render buffer");
+            return NULL;
+        }
+        pdfBitmap = FPDFBitmap_CreateEx(canvasHorSize, canvasVerSize, FPDFBitmap_BGR, bm->tmp,
+                                        canvasHorSize * sizeof(rgb));
+    } else {
+        pdfBitmap = FPDFBitmap_CreateEx(canvasHorSize, canvasVerSize, FPDFBitmap_BGRA, bm->addr,
+                                        bm->info.stride);
+    }
+    if (pdfBitmap == NULL)
+        return NULL;
+
+    fillBackground(pdfBitmap, canvasHorSize, canvasVerSize, 0, startX, startY, drawSizeHor,
+                   drawSizeVer, bm->tmp != NULL);
+
+    return pdfBitmap;
+}
+
+// Grow strip buffer for rows of stride bytes. Returns band height fitted into BAND_SIZE (at least
+// BAND_ROWS), or 0 if out of memory. Must be called under sLibraryLock.
+static int allocBand(int stride, int height) {
+    int bandHeight = BAND_SIZE / stride;
+    if (bandHeight < BAND_ROWS)
+        bandHeight = BAND_ROWS;
+    if (bandHeight > height)
+        bandHeight = height;
+
+    size_t size = (size_t) bandHeight * stride;
+    if (size > sBandSize) {
+        void *band = realloc(sBand, size);
+        if (band == NULL) {
+            LOGE("Unable to allocate band buffer");
+            return 0;
+        }
+        sBand = band;
+        sBandSize = size;
+    }
+    return bandHeight;
+}
+
+// Convert rows of strip buffer (RGB888) into target of any format, top is target row of first band row
+static void convertBand(BITMAP *bm, int stride, int top, int x, int width, int height) {
+    const char *src = (const char *) sBand + x * sizeof(rgb);
+    char *dst = (char *) bm->addr + top * bm->info.stride + x * bytesPerPixel(bm->format);
+    switch (bm->format) {
+        case FORMAT_GRAY:
+            rgbToGray(src, stride, dst, bm->info.stride, width, height);
+            break;
+        case FORMAT_RGB_565:
+            rgbTo565(src, stride, dst, bm->info.stride, width, height, x, top, bm->dither);
+            break;
+        default:
+            rgbTo888(src, stride, dst, bm->info.stride, width, height, bytesPerPixel(bm->format),
+                     bm->format != FORMAT_RGBA);
+    }
+}
+
+// Render RGB_565 or gray target band by band through small reusable BGR strip buffer, instead of
+// canvas size temporary buffer. Each band is rendered through matrix with band clip, so page objects
+// outside of the band are culled. Must be called under sLibraryLock.
+void renderBands(FPDF_PAGE page, BITMAP *bm, int startX, int startY, int drawSizeHor,
+                 int drawSizeVer, int flags) {
+    int canvasHorSize = bm->info.width;
+    int canvasVerSize = bm->info.height;
+    int stride = canvasHorSize * sizeof(rgb);
+    int bandHeight = allocBand(stride, canvasVerSize);
+    if (bandHeight == 0)
+        return;
+
+    // FPDF_RenderPageBitmap(startX, startY, drawSizeHor, drawSizeVer, 0) viewport as matrix over
+    // page points (top left origin, page /Rotate applied)
+    float pageWidth = FPDF_GetPageWidthF(page);
+    float pageHeight = FPDF_GetPageHeightF(page);
+    if (pageWidth <= 0 || pageHeight <= 0)
+        return;
+    FS_MATRIX m = {drawSizeHor / pageWidth, 0, 0, drawSizeVer / pageHeight, (float) startX,
+                   (float) startY};
+
+    for (int top = 0; top < canvasVerSize; top += bandHeight) {
+        int height = canvasVerSize - top < bandHeight ? canvasVerSize - top : bandHeight;
+        FPDF_BITMAP pdfBitmap = FPDFBitmap_CreateEx(canvasHorSize, height, FPDFBitmap_BGR, sBand,
+                                                    stride);
+        fillBackground(pdfBitmap, canvasHorSize, canvasVerSize, top, startX, startY, drawSizeHor,
+                       drawSizeVer, true);
+        FS_MATRIX band = m;
+        band.f -= top;
+        FS_RECTF clip = {0, 0, (float) canvasHorSize, (float) height};
+        FPDF_RenderPageBitmapWithMatrix(pdfBitmap, page, &band, &clip, flags);
+        FPDFBitmap_Destroy(pdfBitmap);
+        convertBand(bm, stride, top, 0, canvasHorSize, height);
+    }
+}
+
+// Render page into locked target of any FORMAT_*. Formats without alpha get white page background,
+// alpha formats keep caller background. Must be called under sLibraryLock.
+void renderBitmap(FPDF_PAGE page, BITMAP *bm, int startX, int startY, int drawSizeHor,
+                  int drawSizeVer, int flags) {
+    flags &= ~RENDER_DITHER;
+
+    if (bm->format == FORMAT_RGB_565 || bm->format == FORMAT_GRAY) {
+        renderBands(page, bm, startX, startY, drawSizeHor, drawSizeVer,
+                    flags | FPDF_REVERSE_BYTE_ORDER);
+        return;
+    }
+
+    int format = bm->format == FORMAT_BGR ? FPDFBitmap_BGR : FPDFBitmap_BGRA;
+    if (bm->format == FORMAT_RGBA)
+        flags |= FPDF_REVERSE_BYTE_ORDER;
+
+    FPDF_BITMAP pdfBitmap = FPDFBitmap_CreateEx(bm->info.width, bm->info.height, format, bm->addr,
+                                                bm->info.stride);
+    fillBackground(pdfBitmap, bm->info.width, bm->info.height, 0, startX, startY, drawSizeHor,
+                   drawSizeVer, bm->format == FORMAT_BGR);
+    FPDF_RenderPageBitmap(pdfBitmap, page,
+                          startX, startY,
+                          drawSizeHor, drawSizeVer,
+                          0, flags);
+    FPDFBitmap_Destroy(pdfBitmap);
 }
 
-void rgbBitmapTo565(void *source, int sourceStride, void *dest, AndroidBitmapInfo *info) {
-    rgb *srcLine;
-    uint16_t *dstLine;
-    int y, x;
-    for (y = 0; y < info->height; y++) {
-        srcLine = (rgb *) source;
-        dstLine = (uint16_t *) dest;
-        for (x = 0; x < info->width; x++) {
-            rgb *r = &srcLine[x];
-            dstLine[x] = rgb_to_565(r->red, r->green, r->blue);
+// Render page through matrix (page points, top left origin -> target pixels) inside clip rect (target
+// pixels). Pixels outside clip are untouched, no canvas size background fill. Must be called under
+// sLibraryLock.
+void renderMatrix(FPDF_PAGE page, BITMAP *bm, const FS_MATRIX *matrix, const FS_RECTF *clip,
+                  int flags) {
+    flags &= ~RENDER_DITHER;
+
+    int width = bm->info.width;
+    int height = bm->info.height;
+    int left = clip->left > 0 ? (int) floorf(clip->left) : 0;
+    int top = clip->top > 0 ? (int) floorf(clip->top) : 0;
+    int right = clip->right < width ? (int) ceilf(clip->right) : width;
+    int bottom = clip->bottom < height ? (int) ceilf(clip->bottom) : height;
+    if (left >= right || top >= bottom)
+        return;
+
+    if (bm->format == FORMAT_RGB_565 || bm->format == FORMAT_GRAY) {
+        int stride = width * sizeof(rgb);
+        int bandHeight = allocBand(stride, bottom - top);
+        if (bandHeight == 0)
+            return;
+        for (int y = top; y < bottom; y += bandHeight) {
+            int rows = bottom - y < bandHeight ? bottom - y : bandHeight;
+            FPDF_BITMAP pdfBitmap = FPDFBitmap_CreateEx(width, rows, FPDFBitmap_BGR, sBand, stride);
+            FPDFBitmap_FillRect(pdfBitmap, left, 0, right - left, rows, 0xFFFFFFFF); // White
+            FS_MATRIX m = *matrix;
+            m.f -= y;
+            FS_RECTF c = {clip->left, clip->top - y, clip->right, clip->bottom - y};
+            FPDF_RenderPageBitmapWithMatrix(pdfBitmap, page, &m, &c,
+                                            flags | FPDF_REVERSE_BYTE_ORDER);
+            FPDFBitmap_Destroy(pdfBitmap);
+            convertBand(bm, stride, y, left, right - left, rows);
         }
-        source = (char *) source + sourceStride;
-        dest = (char *) dest + info->stride;
+        return;
+    }
+
+    int format = bm->format == FORMAT_BGR ? FPDFBitmap_BGR : FPDFBitmap_BGRA;
+    if (bm->format == FORMAT_RGBA)
+        flags |= FPDF_REVERSE_BYTE_ORDER;
+
+    FPDF_BITMAP pdfBitmap = FPDFBitmap_CreateEx(width, height, format, bm->addr, bm->info.stride);
+    if (bm->format == FORMAT_BGR)
+        FPDFBitmap_FillRect(pdfBitmap, left, top, right - left, bottom - top, 0xFFFFFFFF); // White
+    FPDF_RenderPageBitmapWithMatrix(pdfBitmap, page, matrix, clip, flags);
+    FPDFBitmap_Destroy(pdfBitmap);
+}
+
+// Paint alpha format target white, renderBitmap() keeps their background. Other formats are filled
+// while rendering. Must be called under sLibraryLock.
+void fillWhite(BITMAP *bm) {
+    if (bm->format != FORMAT_BGRA && bm->format != FORMAT_RGBA)
+        return;
+    FPDF_BITMAP pdfBitmap = FPDFBitmap_CreateEx(bm->info.width, bm->info.height, FPDFBitmap_BGRA,
+                                                bm->addr, bm->info.stride);
+    FPDFBitmap_FillRect(pdfBitmap, 0, 0, bm->info.width, bm->info.height, 0xFFFFFFFF); // White
+    FPDFBitmap_Destroy(pdfBitmap);
+}
+
+// Describe caller memory as render target. capacity is buffer size in bytes or -1 when unknown.
+// Returns false if format is unknown or geometry does not fit the buffer.
+bool initMemory(BITMAP *bm, void *addr, jlong capacity, int width, int height, int stride,
+                int format, int flags) {
+    int bpp = bytesPerPixel(format);
+    if (bpp == 0 || width <= 0 || height <= 0 || stride < width * bpp)
+        return false;
+    if (capacity >= 0 && capacity < (jlong) stride * (height - 1) + width * bpp)
+        return false;
+
+    bm->info.width = width;
+    bm->info.height = height;
+    bm->info.stride = stride;
+    bm->format = format;
+    bm->addr = addr;
+    bm->tmp = NULL;
+    bm->dither = (flags & RENDER_DITHER) != 0;
+    return true;
+}
+
+void unlockBitmap(JNIEnv *env, jobject bitmap, BITMAP *bm, bool commit) {
+    if (bm->tmp != NULL) {
+        if (commit)
+            rgbTo565(bm->tmp, bm->info.width * sizeof(rgb), bm->addr, bm->info.stride,
+                     bm->info.width, bm->info.height, 0, 0, bm->dither);
+        free(bm->tmp);
+    }
+    AndroidBitmap_unlockPixels(env, bitmap);
+}
+
+static long long uptimeMillis() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+typedef struct {
+    JNIEnv *env;
+    jobject cancel; // Pdfium.Cancel token or NULL
+    int slice; // time budget per slice in milliseconds, 0 - unlimited
+    long long deadline;
+} PAUSE;
+
+static bool isCancelled(PAUSE *p) {
+    return p->cancel != NULL && p->env->GetBooleanField(p->cancel, sJni.cancelCancelled);
+}
+
+static FPDF_BOOL needToPauseNow(IFSDK_PAUSE *pThis) {
+    PAUSE *p = (PAUSE *) pThis->user;
+    if (p->slice > 0 && uptimeMillis() >= p->deadline)
+        return 1;
+    return isCancelled(p);
+}
+
+void releaseAvail(DataAvail *avail) {
+    if (avail != NULL && --avail->refs == 0)
+        delete avail;
+}
+
+void throwOpenError(JNIEnv *env) {
+    const long errorNum = FPDF_GetLastError();
+    if (errorNum == FPDF_ERR_PASSWORD) {
+        jniThrowException(env, "com/github/axet/pdfium/Pdfium$PdfPasswordException",
+                          "Password required or incorrect password.");
+    } else {
+        char *error = getErrorDescription(errorNum);
+        jniThrowExceptionFmt(env, "java/io/IOException",
+                             "cannot create document: %s", error);
+
+        free(error);
     }
 }
 
+class DOCUMENT;
+
+// Document wide search session, scans pages one by one keeping current page search open between
+// calls. pdfium handles are guarded by sLibraryLock, owner closes them when document is closed first.
+typedef struct {
+    DOCUMENT *owner; // NULL after document close
+    std::vector<unsigned short> query; // zero terminated UTF-16
+    int flags;
+    int index; // current page
+    FPDF_PAGE page;
+    FPDF_TEXTPAGE text;
+    FPDF_SCHHANDLE search;
+} FINDER;
+
+static void closeFinderPage(FINDER *f) {
+    if (f->search != NULL)
+        FPDFText_FindClose(f->search);
+    if (f->text != NULL)
+        FPDFText_ClosePage(f->text);
+    if (f->page != NULL)
+        FPDF_ClosePage(f->page);
+    f->search = NULL;
+    f->text = NULL;
+    f->page = NULL;
+}
+
+// Native document state, stored in Pdfium.handle
+class DOCUMENT {
+public:
+    FPDF_DOCUMENT doc;
+    PageTable pages;
+    void *map; // read only file mapping backing the document or MAP_FAILED
+    size_t mapSize;
+    FileLoader *loader; // block cache backing the document or NULL
+    DataAvail *avail; // availability provider backing partially downloaded document or NULL
+    OutlineTree outline; // visited outline nodes, valid handles for getOutline()
+    SectionIndex *sections; // page to outline entries, built on first use
+    NameTable names; // page labels and named destinations
+    std::set<FPDF_PAGE> rendering; // pages with progressive render running (pdfium render context alive)
+    std::set<FINDER *> finders; // open search sessions holding document pages
+
+    DOCUMENT(FPDF_DOCUMENT doc) : doc(doc), map(MAP_FAILED), mapSize(0), loader(NULL),
+                                  avail(NULL), sections(NULL) {
+        pages.init(FPDF_GetPageCount(doc));
+    }
+
+    ~DOCUMENT() {
+        for (std::set<FINDER *>::iterator i = finders.begin(); i != finders.end(); ++i) {
+            closeFinderPage(*i);
+            (*i)->owner = NULL;
+        }
+        FPDF_CloseDocument(doc);
+        if (map != MAP_FAILED)
+            munmap(map, mapSize);
+        delete loader;
+        delete sections;
+        releaseAvail(avail);
+    }
+};
+
 jobject outerObject(JNIEnv *env, jobject thiz) {
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID outerField = env->GetFieldID(cls, "this$0", "Lcom/github/axet/pdfium/Pdfium;");
-    return env->GetObjectField(thiz, outerField);
+    return env->GetObjectField(thiz, sJni.pageOuter);
 }
 
 jlong outerHandle(JNIEnv *env, jobject thiz) {
     jobject outer = outerObject(env, thiz);
-    jclass cls = env->FindClass("com/github/axet/pdfium/Pdfium");
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    return env->GetLongField(outer, fid);
+    jlong handle = env->GetLongField(outer, sJni.pdfiumHandle);
+    env->DeleteLocalRef(outer);
+    return handle;
+}
+
+// Page handle for rendering, must be called under sLibraryLock. NULL with pending IllegalStateException if page
+// is closed or its progressive render is running: pdfium keeps single render context per page.
+static FPDF_PAGE getRenderPage(JNIEnv *env, jobject thiz) {
+    FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, sJni.pageHandle);
+    DOCUMENT *document = (DOCUMENT *) outerHandle(env, thiz);
+    if (page == NULL || document == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Page closed");
+        return NULL;
+    }
+    if (document->rendering.count(page) != 0) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Page progressive render running");
+        return NULL;
+    }
+    return page;
+}
+
+// Wait until progressive render of page (NULL: any page) of pdfium document ends. Called with sLibraryLock
+// held, drops it while waiting. Returns current document, NULL if it was closed meanwhile.
+static DOCUMENT *waitRendering(JNIEnv *env, jobject pdfium, FPDF_PAGE page) {
+    DOCUMENT *document;
+    while ((document = (DOCUMENT *) env->GetLongField(pdfium, sJni.pdfiumHandle)) != NULL &&
+           (page != NULL ? document->rendering.count(page) != 0 : !document->rendering.empty())) {
+        sLibraryLock.unlock();
+        usleep(1000);
+        sLibraryLock.lock();
+    }
+    return document;
+}
+
+static jclass findClass(JNIEnv *env, const char *name) {
+    jclass cls = env->FindClass(name);
+    if (cls == NULL) {
+        LOGE("Unable to find class %s", name);
+        return NULL;
+    }
+    jclass ref = (jclass) env->NewGlobalRef(cls);
+    env->DeleteLocalRef(cls);
+    return ref;
+}
+
+static bool initJni(JNIEnv *env) {
+    if ((sJni.pdfium = findClass(env, "com/github/axet/pdfium/Pdfium")) == NULL ||
+        (sJni.page = findClass(env, "com/github/axet/pdfium/Pdfium$Page")) == NULL ||
+        (sJni.text = findClass(env, "com/github/axet/pdfium/Pdfium$Text")) == NULL ||
+        (sJni.search = findClass(env, "com/github/axet/pdfium/Pdfium$Search")) == NULL ||
+        (sJni.textResult = findClass(env, "com/github/axet/pdfium/Pdfium$TextResult")) == NULL ||
+        (sJni.bookmark = findClass(env, "com/github/axet/pdfium/Pdfium$Bookmark")) == NULL ||
+        (sJni.link = findClass(env, "com/github/axet/pdfium/Pdfium$Link")) == NULL ||
+        (sJni.outline = findClass(env, "com/github/axet/pdfium/Pdfium$Outline")) == NULL ||
+        (sJni.description = findClass(env, "com/github/axet/pdfium/Pdfium$Description")) == NULL ||
+        (sJni.size = findClass(env, "com/github/axet/pdfium/Pdfium$Size")) == NULL ||
+        (sJni.rect = findClass(env, "android/graphics/Rect")) == NULL ||
+        (sJni.point = findClass(env, "android/graphics/Point")) == NULL)
+        return false;
+
+    jclass cancel = env->FindClass("com/github/axet/pdfium/Pdfium$Cancel");
+    jclass fileDescriptor = env->FindClass("java/io/FileDescriptor");
+    jclass avail = env->FindClass("com/github/axet/pdfium/Pdfium$Avail");
+    jclass job = env->FindClass("com/github/axet/pdfium/Pdfium$RenderJob");
+    jclass index = env->FindClass("com/github/axet/pdfium/Pdfium$Index");
+    jclass finder = env->FindClass("com/github/axet/pdfium/Pdfium$Finder");
+    if (cancel == NULL || fileDescriptor == NULL || avail == NULL || job == NULL || index == NULL ||
+        finder == NULL)
+        return false;
+
+    sJni.pdfiumHandle = env->GetFieldID(sJni.pdfium, "handle", "J");
+    sJni.pageInit = env->GetMethodID(sJni.page, "<init>", "(Lcom/github/axet/pdfium/Pdfium;)V");
+    sJni.pageHandle = env->GetFieldID(sJni.page, "handle", "J");
+    sJni.pageIndex = env->GetFieldID(sJni.page, "index", "I");
+    sJni.pageOuter = env->GetFieldID(sJni.page, "this$0", "Lcom/github/axet/pdfium/Pdfium;");
+    sJni.pageLinks = env->GetFieldID(sJni.page, "links", "J");
+    sJni.textInit = env->GetMethodID(sJni.text, "<init>", "()V");
+    sJni.textCache = env->GetFieldID(sJni.text, "cache", "J");
+    sJni.textPage = env->GetFieldID(sJni.text, "page", "J");
+    sJni.textHandle = env->GetFieldID(sJni.text, "handle", "J");
+    sJni.searchInit = env->GetMethodID(sJni.search, "<init>", "()V");
+    sJni.searchHandle = env->GetFieldID(sJni.search, "handle", "J");
+    sJni.textResultInit = env->GetMethodID(sJni.textResult, "<init>", "(II)V");
+    sJni.bookmarkInit = env->GetMethodID(sJni.bookmark, "<init>", "(Ljava/lang/String;II)V");
+    sJni.linkInit = env->GetMethodID(sJni.link, "<init>",
+                                     "(Ljava/lang/String;ILandroid/graphics/Rect;)V");
+    sJni.outlineInit = env->GetMethodID(sJni.outline, "<init>", "([J[ILjava/lang/String;Z)V");
+    sJni.descriptionInit = env->GetMethodID(sJni.description, "<init>",
+                                            "([Ljava/lang/String;IIJFF)V");
+    sJni.sizeInit = env->GetMethodID(sJni.size, "<init>", "(II)V");
+    sJni.cancelCancelled = env->GetFieldID(cancel, "cancelled", "Z");
+    sJni.rectInit = env->GetMethodID(sJni.rect, "<init>", "(IIII)V");
+    sJni.pointInit = env->GetMethodID(sJni.point, "<init>", "(II)V");
+    sJni.fileDescriptorDescriptor = env->GetFieldID(fileDescriptor, "descriptor", "I");
+    sJni.availHandle = env->GetFieldID(avail, "handle", "J");
+    sJni.jobPage = env->GetFieldID(job, "page", "I");
+    sJni.jobBitmap = env->GetFieldID(job, "bitmap", "Landroid/graphics/Bitmap;");
+    sJni.jobBuffer = env->GetFieldID(job, "buffer", "Ljava/nio/ByteBuffer;");
+    sJni.jobWidth = env->GetFieldID(job, "width", "I");
+    sJni.jobHeight = env->GetFieldID(job, "height", "I");
+    sJni.jobStride = env->GetFieldID(job, "stride", "I");
+    sJni.jobFormat = env->GetFieldID(job, "format", "I");
+    sJni.jobStartX = env->GetFieldID(job, "startX", "I");
+    sJni.jobStartY = env->GetFieldID(job, "startY", "I");
+    sJni.jobDrawSizeX = env->GetFieldID(job, "drawSizeX", "I");
+    sJni.jobDrawSizeY = env->GetFieldID(job, "drawSizeY", "I");
+    sJni.jobFlags = env->GetFieldID(job, "flags", "I");
+    sJni.jobStatus = env->GetFieldID(job, "status", "I");
+    sJni.indexHandle = env->GetFieldID(index, "handle", "J");
+    sJni.finderHandle = env->GetFieldID(finder, "handle", "J");
+    sJni.finderOuter = env->GetFieldID(finder, "this$0", "Lcom/github/axet/pdfium/Pdfium;");
+
+    env->DeleteLocalRef(cancel);
+    env->DeleteLocalRef(fileDescriptor);
+    env->DeleteLocalRef(avail);
+    env->DeleteLocalRef(job);
+    env->DeleteLocalRef(index);
+    env->DeleteLocalRef(finder);
+
+    return !env->ExceptionCheck();
 }
 
 extern "C" { //For JNI support
 
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
+    JNIEnv *env;
+    if (vm->GetEnv((void **) &env, JNI_VERSION_1_6) != JNI_OK)
+        return JNI_ERR;
+    if (!initJni(env)) {
+        LOGE("Unable to resolve JNI classes");
+        return JNI_ERR;
+    }
+    return JNI_VERSION_1_6;
+}
+
 JNI_FUNC(void, Pdfium, FPDF_1InitLibrary)(JNIEnv *env, jclass cls) {
     Mutex::Autolock lock(sLibraryLock);
     initLibraryIfNeed();
@@ -209,7 +804,7 @@ static int getBlock(void *param, unsigned long position, unsigned char *outBuffe
     return 1;
 }
 
-JNI_FUNC(void, Pdfium, open)(JNI_ARGS, jobject pfd, jstring password) {
+JNI_FUNC(void, Pdfium, open)(JNI_ARGS, jobject pfd, jstring password, jint flags) {
     Mutex::Autolock lock(sLibraryLock);
 
     initLibraryIfNeed();
@@ -223,67 +818,203 @@ JNI_FUNC(void, Pdfium, open)(JNI_ARGS, jobject pfd, jstring password) {
         return;
     }
 
-    FPDF_FILEACCESS loader;
-    loader.m_FileLen = fileLength;
-    loader.m_Param = reinterpret_cast<void *>(intptr_t(fd));
-    loader.m_GetBlock = &getBlock;
+    void *map = MAP_FAILED;
+    if ((flags & OPEN_MMAP) && fileLength <= INT_MAX) {
+        map = mmap(NULL, fileLength, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED)
+            LOGD("Unable to mmap file descriptor, fallback to pread. Error:%d", errno);
+    }
 
     const char *cpassword = NULL;
     if (password != NULL) {
         cpassword = env->GetStringUTFChars(password, NULL);
     }
 
-    FPDF_DOCUMENT document = FPDF_LoadCustomDocument(&loader, cpassword);
+    FileLoader *cache = NULL;
+    FPDF_DOCUMENT document;
+    if (map != MAP_FAILED) {
+        document = FPDF_LoadMemDocument(map, (int) fileLength, cpassword);
+    } else if (flags & OPEN_CACHE) {
+        cache = new FileLoader(fd, fileLength, CACHE_SIZE);
+        document = FPDF_LoadCustomDocument(cache->getAccess(), cpassword);
+    } else {
+        FPDF_FILEACCESS loader;
+        loader.m_FileLen = fileLength;
+        loader.m_Param = reinterpret_cast<void *>(intptr_t(fd));
+        loader.m_GetBlock = &getBlock;
+        document = FPDF_LoadCustomDocument(&loader, cpassword);
+    }
 
     if (cpassword != NULL) {
         env->ReleaseStringUTFChars(password, cpassword);
     }
 
     if (!document) {
-        const long errorNum = FPDF_GetLastError();
-        if (errorNum == FPDF_ERR_PASSWORD) {
-            jniThrowException(env, "com/github/axet/pdfium/Pdfium$PdfPasswordException",
-                              "Password required or incorrect password.");
-        } else {
-            char *error = getErrorDescription(errorNum);
-            jniThrowExceptionFmt(env, "java/io/IOException",
-                                 "cannot create document: %s", error);
+        if (map != MAP_FAILED)
+            munmap(map, fileLength);
+        delete cache;
+        throwOpenError(env);
+        return;
+    }
 
-            free(error);
-        }
+    DOCUMENT *d = new DOCUMENT(document);
+    d->map = map;
+    d->mapSize = fileLength;
+    d->loader = cache;
+    env->SetLongField(thiz, sJni.pdfiumHandle, (jlong) d);
+}
+
+JNI_FUNC(void, Pdfium, close)(JNI_ARGS) {
+    Mutex::Autolock lock(sLibraryLock);
+    DOCUMENT *document = waitRendering(env, thiz, NULL); // progressive renders of document pages
+    if (document != NULL) {
+        sTileCache.evict(document);
+        Mutex::Autolock release(sDocumentLock); // wait for getPageSize() / getPageInfo() readers
+        env->SetLongField(thiz, sJni.pdfiumHandle, (jlong) 0);
+        delete document;
+    }
+}
+
+JNI_FUNC(void, Pdfium, openAvail)(JNI_ARGS, jobject a, jstring password) {
+    Mutex::Autolock lock(sLibraryLock);
+    DataAvail *avail = (DataAvail *) env->GetLongField(a, sJni.availHandle);
+    if (avail == NULL) {
+        jniThrowException(env, "java/io/IOException", "Avail is closed");
+        return;
+    }
+
+    const char *cpassword = NULL;
+    if (password != NULL) {
+        cpassword = env->GetStringUTFChars(password, NULL);
+    }
+
+    FPDF_DOCUMENT document = FPDFAvail_GetDocument(avail->avail, cpassword);
+
+    if (cpassword != NULL) {
+        env->ReleaseStringUTFChars(password, cpassword);
+    }
 
+    if (!document) {
+        throwOpenError(env);
         return;
     }
 
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    env->SetLongField(thiz, fid, (jlong) document);
+    DOCUMENT *d = new DOCUMENT(document);
+    d->avail = avail;
+    avail->refs++;
+    env->SetLongField(thiz, sJni.pdfiumHandle, (jlong) d);
 }
 
-JNI_FUNC(void, Pdfium, close)(JNI_ARGS) {
+JNI_FUNC(jint, Pdfium, getFirstAvailPage)(JNI_ARGS) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_DOCUMENT doc = (FPDF_DOCUMENT) env->GetLongField(thiz, fid);
-    if (doc != NULL) {
-        FPDF_CloseDocument(doc);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    FPDF_DOCUMENT doc = document != NULL ? document->doc : NULL;
+    return FPDFAvail_GetFirstPageNum(doc);
+}
+
+JNI_FUNC(void, Pdfium_00024Avail, open)(JNI_ARGS, jobject pfd, jlong length) {
+    Mutex::Autolock lock(sLibraryLock);
+
+    initLibraryIfNeed();
+
+    if (length <= 0) {
+        jniThrowException(env, "java/io/IOException", "File is empty");
+        return;
+    }
+
+    DataAvail *avail = new DataAvail(getFD(env, pfd), (size_t) length);
+    if (avail->avail == NULL) {
+        delete avail;
+        jniThrowException(env, "java/io/IOException", "cannot create availability provider");
+        return;
+    }
+    env->SetLongField(thiz, sJni.availHandle, (jlong) avail);
+}
+
+JNI_FUNC(void, Pdfium_00024Avail, addRange)(JNI_ARGS, jlong offset, jlong size) {
+    Mutex::Autolock lock(sLibraryLock);
+    DataAvail *avail = (DataAvail *) env->GetLongField(thiz, sJni.availHandle);
+    if (avail != NULL && offset >= 0 && size > 0)
+        avail->addRange((size_t) offset, (size_t) size);
+}
+
+JNI_FUNC(jint, Pdfium_00024Avail, isDocAvail)(JNI_ARGS) {
+    Mutex::Autolock lock(sLibraryLock);
+    DataAvail *avail = (DataAvail *) env->GetLongField(thiz, sJni.availHandle);
+    if (avail == NULL)
+        return PDF_DATA_ERROR;
+    return avail->isDocAvail();
+}
+
+JNI_FUNC(jint, Pdfium_00024Avail, isPageAvail)(JNI_ARGS, jint page) {
+    Mutex::Autolock lock(sLibraryLock);
+    DataAvail *avail = (DataAvail *) env->GetLongField(thiz, sJni.availHandle);
+    if (avail == NULL)
+        return PDF_DATA_ERROR;
+    return avail->isPageAvail(page);
+}
+
+JNI_FUNC(jint, Pdfium_00024Avail, isLinearized)(JNI_ARGS) {
+    Mutex::Autolock lock(sLibraryLock);
+    DataAvail *avail = (DataAvail *) env->GetLongField(thiz, sJni.availHandle);
+    if (avail == NULL)
+        return PDF_LINEARIZATION_UNKNOWN;
+    return FPDFAvail_IsLinearized(avail->avail);
+}
+
+JNI_FUNC(jlongArray, Pdfium_00024Avail, getHints)(JNI_ARGS) {
+    Mutex::Autolock lock(sLibraryLock);
+    DataAvail *avail = (DataAvail *) env->GetLongField(thiz, sJni.availHandle);
+    if (avail == NULL)
+        return NULL;
+    std::vector<RANGE> hints = avail->getHints();
+    std::vector<jlong> packed;
+    for (size_t i = 0; i < hints.size(); i++) {
+        packed.push_back((jlong) hints[i].first);
+        packed.push_back((jlong) hints[i].second);
     }
-    env->SetLongField(thiz, fid, (jlong) 0);
+    jlongArray ar = env->NewLongArray(packed.size());
+    env->SetLongArrayRegion(ar, 0, packed.size(), packed.data());
+    return ar;
+}
+
+JNI_FUNC(void, Pdfium_00024Avail, close)(JNI_ARGS) {
+    Mutex::Autolock lock(sLibraryLock);
+    DataAvail *avail = (DataAvail *) env->GetLongField(thiz, sJni.availHandle);
+    releaseAvail(avail);
+    env->SetLongField(thiz, sJni.availHandle, (jlong) 0);
+}
+
+JNI_FUNC(void, Pdfium, setCacheSize)(JNI_ARGS, jlong bytes) {
+    Mutex::Autolock lock(sLibraryLock);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    if (document != NULL && document->loader != NULL)
+        document->loader->setBudget((size_t) bytes);
+}
+
+JNI_FUNC(jlongArray, Pdfium, getCacheStats)(JNI_ARGS) {
+    Mutex::Autolock lock(sLibraryLock);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    if (document == NULL || document->loader == NULL)
+        return NULL;
+    FileLoader *loader = document->loader;
+    jlong stats[] = {loader->hits, loader->misses, loader->bytesRead, loader->reads};
+    jlongArray ar = env->NewLongArray(4);
+    env->SetLongArrayRegion(ar, 0, 4, stats);
+    return ar;
 }
 
 JNI_FUNC(jint, Pdfium, getPagesCount)(JNI_ARGS) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_DOCUMENT doc = (FPDF_DOCUMENT) env->GetLongField(thiz, fid);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    FPDF_DOCUMENT doc = document != NULL ? document->doc : NULL;
     return (jint) FPDF_GetPageCount(doc);
 }
 
 JNI_FUNC(jstring, Pdfium, getMeta)(JNI_ARGS, jstring str) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_DOCUMENT doc = (FPDF_DOCUMENT) env->GetLongField(thiz, fid);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    FPDF_DOCUMENT doc = document != NULL ? document->doc : NULL;
 
     const char *ctag = env->GetStringUTFChars(str, NULL);
 
@@ -300,38 +1031,18 @@ JNI_FUNC(jstring, Pdfium, getMeta)(JNI_ARGS, jstring str) {
     return NULL;
 }
 
-typedef struct {
-    FPDF_BOOKMARK bm;
-    int level;
-} BOOKMARK;
-
-void loadTOC(JNIEnv *env, std::vector<BOOKMARK> &list, FPDF_DOCUMENT doc, FPDF_BOOKMARK bookmark,
-             int level) {
-    while (bookmark != NULL) {
-        BOOKMARK bm = {
-                bookmark,
-                level
-        };
-        list.push_back(bm);
-        FPDF_BOOKMARK sub = FPDFBookmark_GetFirstChild(doc, bookmark);
-        if (sub != 0)
-            loadTOC(env, list, doc, sub, level + 1);
-        bookmark = FPDFBookmark_GetNextSibling(doc, bookmark);
-    }
-}
-
 JNI_FUNC(jobjectArray, Pdfium, getTOC)(JNI_ARGS) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_DOCUMENT doc = (FPDF_DOCUMENT) env->GetLongField(thiz, fid);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    FPDF_DOCUMENT doc = document != NULL ? document->doc : NULL;
 
     std::vector<BOOKMARK> list;
-    jclass bookmarkCls = env->FindClass("com/github/axet/pdfium/Pdfium$Bookmark");
-    jmethodID constructorID = env->GetMethodID(bookmarkCls, "<init>", "(Ljava/lang/String;II)V");
-    FPDF_BOOKMARK bookmark = FPDFBookmark_GetFirstChild(doc, NULL);
-    loadTOC(env, list, doc, bookmark, 0);
-    jobjectArray ar = env->NewObjectArray(list.size(), bookmarkCls, 0);
+    if (document != NULL) {
+        document->outline.walk(doc, list);
+        if (document->sections == NULL)
+            document->sections = new SectionIndex(list, FPDF_GetPageCount(doc));
+    }
+    jobjectArray ar = env->NewObjectArray(list.size(), sJni.bookmark, 0);
     for (int i = 0; i < list.size(); i++) {
         BOOKMARK bm = list[i];
 
@@ -344,13 +1055,7 @@ JNI_FUNC(jobjectArray, Pdfium, getTOC)(JNI_ARGS) {
             free(msg);
         }
 
-        int page = -1;
-        FPDF_DEST dest = FPDFBookmark_GetDest(doc, bm.bm);
-        if (dest != 0) {
-            page = FPDFDest_GetDestPageIndex(doc, dest);
-        }
-
-        jobject o = env->NewObject(bookmarkCls, constructorID, s, page, bm.level);
+        jobject o = env->NewObject(sJni.bookmark, sJni.bookmarkInit, s, bm.page, bm.level);
         env->SetObjectArrayElement(ar, i, o);
         env->DeleteLocalRef(o);
         env->DeleteLocalRef(s);
@@ -358,75 +1063,1090 @@ JNI_FUNC(jobjectArray, Pdfium, getTOC)(JNI_ARGS) {
     return ar;
 }
 
-JNI_FUNC(jobject, Pdfium, openPage)(JNI_ARGS, jint page) {
-    Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_DOCUMENT doc = (FPDF_DOCUMENT) env->GetLongField(thiz, fid);
+// Outline object for nodes, packed (OUTLINE_STRIDE ints per node, titles concatenated)
+static jobject newOutline(JNIEnv *env, DOCUMENT *document, const std::vector<FPDF_BOOKMARK> &list,
+                          bool more) {
+    FPDF_DOCUMENT doc = document->doc;
+    std::vector<jlong> handles(list.size());
+    std::vector<jint> info(list.size() * OUTLINE_STRIDE);
+    std::vector<jchar> titles;
+    for (size_t i = 0; i < list.size(); i++) {
+        FPDF_BOOKMARK bm = list[i];
+        handles[i] = (jlong) bm;
+
+        unsigned long len = FPDFBookmark_GetTitle(bm, NULL, 0); // bytes, UTF-16LE with terminator
+        if (len > 2) {
+            size_t pos = titles.size();
+            titles.resize(pos + len / 2);
+            FPDFBookmark_GetTitle(bm, &titles[pos], len);
+            titles.pop_back();
+        }
 
-    FPDF_PAGE p = FPDF_LoadPage(doc, page);
-    if (p != 0) {
-        jclass clazz = env->FindClass("com/github/axet/pdfium/Pdfium$Page");
-        jmethodID constructorID = env->GetMethodID(clazz, "<init>",
-                                                   "(Lcom/github/axet/pdfium/Pdfium;)V");
-        jfieldID fid1 = env->GetFieldID(clazz, "handle", "J");
-        jobject o = env->NewObject(clazz, constructorID, thiz);
-        env->SetLongField(o, fid1, (jlong) p);
-        return o;
-    } else {
-        return 0;
+        int page = -1;
+        FPDF_DEST dest = FPDFBookmark_GetDest(doc, bm);
+        if (dest != 0)
+            page = FPDFDest_GetDestPageIndex(doc, dest);
+
+        jint *v = &info[i * OUTLINE_STRIDE];
+        v[0] = page;
+        v[1] = document->outline.hasChildren(doc, bm) ? OUTLINE_CHILDREN : 0;
+        v[2] = titles.size();
     }
+
+    jlongArray h = env->NewLongArray(handles.size());
+    env->SetLongArrayRegion(h, 0, handles.size(), handles.data());
+    jintArray in = env->NewIntArray(info.size());
+    env->SetIntArrayRegion(in, 0, info.size(), info.data());
+    jstring t = env->NewString(titles.data(), titles.size());
+    jobject o = env->NewObject(sJni.outline, sJni.outlineInit, h, in, t, (jboolean) more);
+    env->DeleteLocalRef(h);
+    env->DeleteLocalRef(in);
+    env->DeleteLocalRef(t);
+    return o;
 }
 
-JNI_FUNC(jobject, Pdfium, getPageSize)(JNI_ARGS, jint pageIndex) {
+JNI_FUNC(jobject, Pdfium, getOutlineBatch)(JNI_ARGS, jlong parent, jlong after, jint max) {
+    if (max < 1) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "max < 1");
+        return NULL;
+    }
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_DOCUMENT doc = (FPDF_DOCUMENT) env->GetLongField(thiz, fid);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    if (document == NULL)
+        return NULL;
+    FPDF_DOCUMENT doc = document->doc;
+
+    std::vector<FPDF_BOOKMARK> list;
+    bool more;
+    if (!document->outline.children(doc, (FPDF_BOOKMARK) parent, (FPDF_BOOKMARK) after, max, list,
+                                    &more)) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "Unknown outline node");
+        return NULL;
+    }
+    return newOutline(env, document, list, more);
+}
+
+// Section index, built by walking whole outline on first use. Must be called under sLibraryLock.
+static SectionIndex *getSections(DOCUMENT *document) {
+    if (document->sections == NULL) {
+        std::vector<BOOKMARK> list;
+        document->outline.walk(document->doc, list);
+        document->sections = new SectionIndex(list, FPDF_GetPageCount(document->doc));
+    }
+    return document->sections;
+}
 
-    double width, height;
-    int result = FPDF_GetPageSizeByIndex(doc, pageIndex, &width, &height);
+JNI_FUNC(jobject, Pdfium, getSectionsPage)(JNI_ARGS, jint page) {
+    Mutex::Autolock lock(sLibraryLock);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    if (document == NULL)
+        return NULL;
+    SectionIndex *sections = getSections(document);
+    std::vector<int> ids;
+    sections->find(page, ids);
+    std::vector<FPDF_BOOKMARK> list;
+    for (size_t i = 0; i < ids.size(); i++)
+        list.push_back(sections->get(ids[i]));
+    return newOutline(env, document, list, false);
+}
 
-    if (result == 0) {
-        width = 0;
-        height = 0;
+JNI_FUNC(jintArray, Pdfium, getSectionsRange)(JNI_ARGS, jint first, jint count) {
+    if (first < 0 || count < 0) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "Negative first or count");
+        return NULL;
+    }
+    std::vector<jint> ids;
+    {
+        Mutex::Autolock lock(sLibraryLock);
+        DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+        if (document == NULL)
+            return NULL;
+        int pages = FPDF_GetPageCount(document->doc);
+        if (first > pages)
+            first = pages;
+        if (count > pages - first) // clamp to document pages
+            count = pages - first;
+        ids.resize(count);
+        SectionIndex *sections = getSections(document);
+        for (int i = 0; i < count; i++)
+            ids[i] = sections->findInner(first + i);
     }
+    jintArray ar = env->NewIntArray(count);
+    env->SetIntArrayRegion(ar, 0, count, ids.data());
+    return ar;
+}
 
-    jclass clazz = env->FindClass("com/github/axet/pdfium/Pdfium$Size");
-    jmethodID constructorID = env->GetMethodID(clazz, "<init>", "(II)V");
-    return env->NewObject(clazz, constructorID, (int) width, (int) height);
+static jstring newString(JNIEnv *env, const std::u16string &s) {
+    if (s.empty())
+        return NULL;
+    return env->NewString((const jchar *) s.data(), s.size());
 }
 
-JNI_FUNC(jint, Pdfium, getVersion)(JNI_ARGS) {
-    Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_DOCUMENT doc = (FPDF_DOCUMENT) env->GetLongField(thiz, fid);
-    int version = 0;
-    if (!FPDF_GetFileVersion(doc, &version))
-        return 0;
-    return version;
+static std::u16string getString(JNIEnv *env, jstring str) {
+    const jchar *chars = env->GetStringChars(str, NULL);
+    std::u16string s((const char16_t *) chars, env->GetStringLength(str));
+    env->ReleaseStringChars(str, chars);
+    return s;
 }
 
-JNI_FUNC(void, Pdfium_00024Page, render)(JNI_ARGS, jobject bitmap,
-                                         jint startX, jint startY,
-                                         jint drawSizeHor, jint drawSizeVer,
-                                         jint flags) {
+JNI_FUNC(jstring, Pdfium, getPageLabel)(JNI_ARGS, jint page) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, fid);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    if (document == NULL)
+        return NULL;
+    if (page < 0 || page >= document->pages.getCount())
+        return NULL;
+    return newString(env, document->names.getLabel(document->doc, page));
+}
 
-    AndroidBitmapInfo info;
-    int ret;
-    if ((ret = AndroidBitmap_getInfo(env, bitmap, &info)) < 0) {
-        LOGE("Fetching bitmap info failed: %s", strerror(ret * -1));
-        return;
+JNI_FUNC(jobjectArray, Pdfium, getPageLabels)(JNI_ARGS) {
+    int count;
+    {
+        Mutex::Autolock lock(sLibraryLock);
+        DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+        if (document == NULL)
+            return NULL;
+        count = document->pages.getCount();
     }
-
-    int canvasHorSize = info.width;
-    int canvasVerSize = info.height;
-
+    jclass string = env->FindClass("java/lang/String");
+    jobjectArray ar = env->NewObjectArray(count, string, 0);
+    env->DeleteLocalRef(string);
+    for (int i = 0; i < count; i++) {
+        sched_yield(); // let waiting threads grab the library lock between pages
+        Mutex::Autolock lock(sLibraryLock);
+        DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+        if (document == NULL)
+            return NULL;
+        jstring s = newString(env, document->names.getLabel(document->doc, i));
+        if (s == NULL)
+            continue;
+        env->SetObjectArrayElement(ar, i, s);
+        env->DeleteLocalRef(s);
+    }
+    return ar;
+}
+
+JNI_FUNC(jint, Pdfium, findPageLabel)(JNI_ARGS, jstring label) {
+    if (label == NULL) {
+        jniThrowException(env, "java/lang/NullPointerException", NULL);
+        return -1;
+    }
+    std::u16string s = getString(env, label);
+    for (;;) { // map labels page by page until found, releasing library lock between pages
+        sched_yield(); // let waiting threads grab the library lock between pages
+        Mutex::Autolock lock(sLibraryLock);
+        DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+        if (document == NULL)
+            return -1;
+        NameTable &names = document->names;
+        int page = names.findLabel(s);
+        if (page != -1 || !names.mapNextLabel(document->doc, document->pages.getCount()))
+            return page;
+    }
+}
+
+JNI_FUNC(jfloatArray, Pdfium, getNamedDest)(JNI_ARGS, jstring name) {
+    if (name == NULL) {
+        jniThrowException(env, "java/lang/NullPointerException", NULL);
+        return NULL;
+    }
+    std::u16string s = getString(env, name);
+    NAMEDDEST d;
+    {
+        Mutex::Autolock lock(sLibraryLock);
+        DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+        if (document == NULL)
+            return NULL;
+        document->names.loadDests(document->doc);
+        if (!document->names.findDest(s, &d))
+            return NULL;
+    }
+    jfloat v[DEST_STRIDE] = {(jfloat) d.page, d.x, d.y, d.zoom};
+    jfloatArray ar = env->NewFloatArray(DEST_STRIDE);
+    env->SetFloatArrayRegion(ar, 0, DEST_STRIDE, v);
+    return ar;
+}
+
+JNI_FUNC(jobject, Pdfium, openPage)(JNI_ARGS, jint page) {
+    Mutex::Autolock lock(sLibraryLock);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    FPDF_DOCUMENT doc = document != NULL ? document->doc : NULL;
+
+    FPDF_PAGE p = FPDF_LoadPage(doc, page);
+    if (p != 0) {
+        jobject o = env->NewObject(sJni.page, sJni.pageInit, thiz);
+        env->SetLongField(o, sJni.pageHandle, (jlong) p);
+        env->SetIntField(o, sJni.pageIndex, page);
+        return o;
+    } else {
+        return 0;
+    }
+}
+
+// Copy cached page info. Cache hits take sDocumentLock only, so they do not wait for rendering threads;
+// misses load sizes under sLibraryLock, boxes page by page releasing the lock between page loads.
+// Returns false if document is closed.
+static bool getPageInfo(JNIEnv *env, jobject thiz, int first, int count, int flags, float *info) {
+    {
+        Mutex::Autolock lock(sDocumentLock);
+        DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+        if (document == NULL || first + count > document->pages.getCount()) // reopened meanwhile
+            return false;
+        if (document->pages.get(first, count, flags, info))
+            return true;
+    }
+    {
+        Mutex::Autolock lock(sLibraryLock);
+        DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle); // closed meanwhile
+        if (document == NULL || first + count > document->pages.getCount())
+            return false;
+        document->pages.load(document->doc, first, count);
+    }
+    bool loaded = false;
+    for (int i = first; i < first + count && (flags & PAGEINFO_BOXES); i++) {
+        if (loaded)
+            sched_yield(); // let waiting threads grab the library lock between page loads
+        Mutex::Autolock lock(sLibraryLock);
+        DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+        if (document == NULL || first + count > document->pages.getCount())
+            return false;
+        loaded = document->pages.loadBoxes(document->doc, i);
+    }
+    Mutex::Autolock lock(sDocumentLock);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    if (document == NULL || first + count > document->pages.getCount())
+        return false;
+    return document->pages.get(first, count, flags, info);
+}
+
+static int getPageCount(JNIEnv *env, jobject thiz) {
+    Mutex::Autolock lock(sDocumentLock);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    return document != NULL ? document->pages.getCount() : 0;
+}
+
+JNI_FUNC(jobject, Pdfium, getPageSize)(JNI_ARGS, jint pageIndex) {
+    float info[PAGEINFO_STRIDE] = {0};
+    if (pageIndex >= 0 && pageIndex < getPageCount(env, thiz))
+        getPageInfo(env, thiz, pageIndex, 1, 0, info);
+
+    return env->NewObject(sJni.size, sJni.sizeInit, (int) info[0], (int) info[1]);
+}
+
+JNI_FUNC(jfloatArray, Pdfium, getPageInfo)(JNI_ARGS, jint first, jint count, jint flags) {
+    int total = getPageCount(env, thiz);
+    if (first < 0)
+        first = 0;
+    if (first > total)
+        first = total;
+    if (count < 0 || count > total - first)
+        count = total - first;
+
+    std::vector<float> info((size_t) count * PAGEINFO_STRIDE);
+    if (count > 0)
+        getPageInfo(env, thiz, first, count, flags, info.data());
+
+    jfloatArray ar = env->NewFloatArray(info.size());
+    env->SetFloatArrayRegion(ar, 0, info.size(), info.data());
+    return ar;
+}
+
+#define JOB_DONE 1 // Pdfium.RenderJob.DONE
+#define JOB_ERROR_PAGE -1 // Pdfium.RenderJob.ERROR_PAGE
+#define JOB_ERROR_TARGET -2 // Pdfium.RenderJob.ERROR_TARGET
+
+// Render single batch job, keeping last loaded page open in page / index so consecutive jobs for
+// the same page (tiles) load it once. Must be called under sLibraryLock.
+static int renderJob(JNIEnv *env, FPDF_DOCUMENT doc, jobject job, FPDF_PAGE *page, int *index) {
+    int pageIndex = env->GetIntField(job, sJni.jobPage);
+    if (pageIndex != *index) {
+        if (*page != NULL)
+            FPDF_ClosePage(*page);
+        *page = FPDF_LoadPage(doc, pageIndex);
+        *index = *page != NULL ? pageIndex : -1;
+    }
+    if (*page == NULL)
+        return JOB_ERROR_PAGE;
+
+    int flags = env->GetIntField(job, sJni.jobFlags);
+
+    BITMAP bm;
+    jobject bitmap = env->GetObjectField(job, sJni.jobBitmap);
+    if (bitmap != NULL) {
+        if (!lockBitmap(env, bitmap, &bm, flags)) {
+            env->DeleteLocalRef(bitmap);
+            return JOB_ERROR_TARGET;
+        }
+    } else {
+        jobject buffer = env->GetObjectField(job, sJni.jobBuffer);
+        void *addr = buffer != NULL ? env->GetDirectBufferAddress(buffer) : NULL;
+        bool ok = addr != NULL && initMemory(&bm, addr, env->GetDirectBufferCapacity(buffer),
+                                             env->GetIntField(job, sJni.jobWidth),
+                                             env->GetIntField(job, sJni.jobHeight),
+                                             env->GetIntField(job, sJni.jobStride),
+                                             env->GetIntField(job, sJni.jobFormat), flags);
+        if (buffer != NULL)
+            env->DeleteLocalRef(buffer);
+        if (!ok)
+            return JOB_ERROR_TARGET;
+    }
+
+    int startX = env->GetIntField(job, sJni.jobStartX);
+    int startY = env->GetIntField(job, sJni.jobStartY);
+    int drawSizeHor = env->GetIntField(job, sJni.jobDrawSizeX);
+    int drawSizeVer = env->GetIntField(job, sJni.jobDrawSizeY);
+    if (drawSizeHor <= 0 || drawSizeVer <= 0) { // fit page into target, centered
+        float w = FPDF_GetPageWidthF(*page);
+        float h = FPDF_GetPageHeightF(*page);
+        if (!(w > 0 && h > 0)) { // degenerate page, nothing to fit
+            if (bitmap != NULL) {
+                unlockBitmap(env, bitmap, &bm, false);
+                env->DeleteLocalRef(bitmap);
+            }
+            return JOB_ERROR_PAGE;
+        }
+        float scale = fminf(bm.info.width / w, bm.info.height / h);
+        drawSizeHor = (int) (w * scale);
+        drawSizeVer = (int) (h * scale);
+        startX = ((int) bm.info.width - drawSizeHor) / 2;
+        startY = ((int) bm.info.height - drawSizeVer) / 2;
+    }
+
+    renderBitmap(*page, &bm, startX, startY, drawSizeHor, drawSizeVer, flags);
+
+    if (bitmap != NULL) {
+        unlockBitmap(env, bitmap, &bm, true);
+        env->DeleteLocalRef(bitmap);
+    }
+    return JOB_DONE;
+}
+
+JNI_FUNC(jint, Pdfium, renderJobs)(JNI_ARGS, jobjectArray jobs) {
+    Mutex::Autolock lock(sLibraryLock);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    if (document == NULL)
+        return 0;
+
+    FPDF_PAGE page = NULL;
+    int index = -1;
+    int done = 0;
+    int count = env->GetArrayLength(jobs);
+    for (int i = 0; i < count; i++) {
+        jobject job = env->GetObjectArrayElement(jobs, i);
+        if (job == NULL)
+            continue;
+        int status = renderJob(env, document->doc, job, &page, &index);
+        env->SetIntField(job, sJni.jobStatus, status);
+        env->DeleteLocalRef(job);
+        if (status == JOB_DONE)
+            done++;
+    }
+    if (page != NULL)
+        FPDF_ClosePage(page);
+
+    return done;
+}
+
+// Render pages first .. first + count - 1 into cellWidth x cellHeight grid cells of atlas, row by row,
+// each page fitted into its cell and centered. Returns page rectangles (left, top, right, bottom) in
+// atlas pixels for pages which fit the grid, zeros for pages failed to load. Must be called under
+// sLibraryLock.
+static jintArray renderAtlas(JNIEnv *env, FPDF_DOCUMENT doc, BITMAP *atlas, int first, int count,
+                             int cellWidth, int cellHeight, int flags) {
+    if (count < 0 || cellWidth <= 0 || cellHeight <= 0) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "Bad atlas geometry");
+        return NULL;
+    }
+    int columns = atlas->info.width / cellWidth;
+    int rows = atlas->info.height / cellHeight;
+    int bpp = bytesPerPixel(atlas->format);
+    if (count > columns * rows)
+        count = columns * rows;
+
+    std::vector<jint> rects((size_t) count * 4, 0);
+    for (int i = 0; i < count; i++) {
+        FPDF_PAGE page = FPDF_LoadPage(doc, first + i);
+        if (page == NULL)
+            continue;
+
+        float w = FPDF_GetPageWidthF(page);
+        float h = FPDF_GetPageHeightF(page);
+        if (!(w > 0 && h > 0)) { // degenerate page, leave cell empty
+            FPDF_ClosePage(page);
+            continue;
+        }
+        float scale = fminf(cellWidth / w, cellHeight / h);
+        int drawSizeHor = (int) (w * scale);
+        int drawSizeVer = (int) (h * scale);
+        int left = (i % columns) * cellWidth + (cellWidth - drawSizeHor) / 2;
+        int top = (i / columns) * cellHeight + (cellHeight - drawSizeVer) / 2;
+
+        if (drawSizeHor > 0 && drawSizeVer > 0) {
+            BITMAP cell = *atlas; // shares atlas stride, starts at page rectangle
+            cell.info.width = drawSizeHor;
+            cell.info.height = drawSizeVer;
+            cell.addr = (char *) atlas->addr + top * atlas->info.stride + left * bpp;
+            fillWhite(&cell);
+            renderBitmap(page, &cell, 0, 0, drawSizeHor, drawSizeVer, flags);
+
+            rects[i * 4] = left;
+            rects[i * 4 + 1] = top;
+            rects[i * 4 + 2] = left + drawSizeHor;
+            rects[i * 4 + 3] = top + drawSizeVer;
+        }
+
+        FPDF_ClosePage(page);
+    }
+
+    jintArray ar = env->NewIntArray(rects.size());
+    env->SetIntArrayRegion(ar, 0, rects.size(), rects.data());
+    return ar;
+}
+
+JNI_FUNC(jintArray, Pdfium, renderAtlas)(JNI_ARGS, jobject bitmap, jint first, jint count,
+                                         jint cellWidth, jint cellHeight, jint flags) {
+    Mutex::Autolock lock(sLibraryLock);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    if (document == NULL)
+        return NULL;
+
+    BITMAP bm;
+    if (!lockBitmap(env, bitmap, &bm, flags))
+        return NULL;
+
+    jintArray ar = renderAtlas(env, document->doc, &bm, first, count, cellWidth, cellHeight, flags);
+
+    unlockBitmap(env, bitmap, &bm, true);
+    return ar;
+}
+
+JNI_FUNC(jintArray, Pdfium, renderAtlasBuffer)(JNI_ARGS, jobject buffer, jint width, jint height,
+                                               jint stride, jint format, jint first, jint count,
+                                               jint cellWidth, jint cellHeight, jint flags) {
+    void *addr = env->GetDirectBufferAddress(buffer);
+    BITMAP bm;
+    if (addr == NULL || !initMemory(&bm, addr, env->GetDirectBufferCapacity(buffer), width, height,
+                                    stride, format, flags)) {
+        jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException",
+                             "Bad buffer: format %d, %dx%d, stride %d", format, width, height,
+                             stride);
+        return NULL;
+    }
+
+    Mutex::Autolock lock(sLibraryLock);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    if (document == NULL)
+        return NULL;
+    return renderAtlas(env, document->doc, &bm, first, count, cellWidth, cellHeight, flags);
+}
+
+#define TEXT_UTF8 1 // Pdfium.TEXT_UTF8, UTF-16LE otherwise
+
+// Append UTF-16 text as UTF-8, unpaired surrogates replaced with U+FFFD
+static void appendUTF8(std::string &out, const unsigned short *s, int len) {
+    for (int i = 0; i < len; i++) {
+        unsigned int c = s[i];
+        if (c >= 0xD800 && c <= 0xDFFF) {
+            if (c <= 0xDBFF && i + 1 < len && s[i + 1] >= 0xDC00 && s[i + 1] <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (s[i + 1] - 0xDC00);
+                i++;
+            } else {
+                c = 0xFFFD;
+            }
+        }
+        if (c < 0x80) {
+            out += (char) c;
+        } else if (c < 0x800) {
+            out += (char) (0xC0 | (c >> 6));
+            out += (char) (0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            out += (char) (0xE0 | (c >> 12));
+            out += (char) (0x80 | ((c >> 6) & 0x3F));
+            out += (char) (0x80 | (c & 0x3F));
+        } else {
+            out += (char) (0xF0 | (c >> 18));
+            out += (char) (0x80 | ((c >> 12) & 0x3F));
+            out += (char) (0x80 | ((c >> 6) & 0x3F));
+            out += (char) (0x80 | (c & 0x3F));
+        }
+    }
+}
+
+// Load whole page text (UTF-16, no trailing zero). Takes sLibraryLock for single page only, so long
+// document walks do not block other threads. Returns false if page can't be loaded.
+static bool loadPageText(JNIEnv *env, jobject thiz, int index, std::vector<unsigned short> &out) {
+    Mutex::Autolock lock(sLibraryLock);
+    out.clear();
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    if (document == NULL)
+        return false;
+    FPDF_PAGE page = FPDF_LoadPage(document->doc, index);
+    if (page == NULL)
+        return false;
+    FPDF_TEXTPAGE text = FPDFText_LoadPage(page);
+    if (text != NULL) {
+        int count = FPDFText_CountChars(text);
+        if (count > 0) {
+            out.resize(count + 1);
+            int len = FPDFText_GetText(text, 0, count, out.data()) - 1; // no trailing zero
+            out.resize(len > 0 ? len : 0);
+        }
+        FPDFText_ClosePage(text);
+    }
+    FPDF_ClosePage(page);
+    return true;
+}
+
+// Load page text in requested encoding
+static bool extractPage(JNIEnv *env, jobject thiz, int index, int flags, std::string &out) {
+    std::vector<unsigned short> buf;
+    if (!loadPageText(env, thiz, index, buf))
+        return false;
+    if (flags & TEXT_UTF8)
+        appendUTF8(out, buf.data(), buf.size());
+    else
+        out.append((const char *) buf.data(), buf.size() * sizeof(unsigned short));
+    return true;
+}
+
+// Check that [first, first + count) lies inside document pages, throws if not
+static bool checkPageRange(JNIEnv *env, jobject thiz, jint first, jint count) {
+    Mutex::Autolock lock(sLibraryLock);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    if (document == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Document closed");
+        return false;
+    }
+    int pages = FPDF_GetPageCount(document->doc);
+    if (first < 0 || count < 0 || first > pages - count) { // no first + count overflow
+        jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException",
+                             "Page range %d+%d out of %d pages", first, count, pages);
+        return false;
+    }
+    return true;
+}
+
+static jlongArray newOffsets(JNIEnv *env, const std::vector<jlong> &offsets) {
+    jlongArray ar = env->NewLongArray(offsets.size());
+    env->SetLongArrayRegion(ar, 0, offsets.size(), offsets.data());
+    return ar;
+}
+
+JNI_FUNC(jlongArray, Pdfium, extractText)(JNI_ARGS, jobject pfd, jint first, jint count,
+                                          jint flags) {
+    if (!checkPageRange(env, thiz, first, count))
+        return NULL;
+    int fd = getFD(env, pfd);
+    std::vector<jlong> offsets;
+    std::string text;
+    jlong pos = 0;
+    offsets.push_back(pos);
+    for (int i = first; i < first + count; i++) {
+        text.clear();
+        if (!extractPage(env, thiz, i, flags, text)) {
+            jniThrowExceptionFmt(env, "java/io/IOException", "cannot load page %d", i);
+            return NULL;
+        }
+        size_t done = 0;
+        while (done < text.size()) { // write outside library lock
+            ssize_t n = write(fd, text.data() + done, text.size() - done);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                jniThrowExceptionFmt(env, "java/io/IOException", "write failed: %s",
+                                     strerror(errno));
+                return NULL;
+            }
+            done += n;
+        }
+        pos += text.size();
+        offsets.push_back(pos);
+    }
+    return newOffsets(env, offsets);
+}
+
+JNI_FUNC(jlongArray, Pdfium, extractTextBuffer)(JNI_ARGS, jobject buffer, jint first, jint count,
+                                                jint flags) {
+    char *addr = (char *) env->GetDirectBufferAddress(buffer);
+    if (addr == NULL) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "Buffer must be direct");
+        return NULL;
+    }
+    if (!checkPageRange(env, thiz, first, count))
+        return NULL;
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    std::vector<jlong> offsets;
+    std::string text;
+    jlong pos = 0;
+    offsets.push_back(pos);
+    for (int i = first; i < first + count; i++) {
+        text.clear();
+        if (!extractPage(env, thiz, i, flags, text)) {
+            jniThrowExceptionFmt(env, "java/io/IOException", "cannot load page %d", i);
+            return NULL;
+        }
+        if (pos + (jlong) text.size() > capacity)
+            break; // buffer full, caller grows buffer and continues from next page
+        memcpy(addr + pos, text.data(), text.size());
+        pos += text.size();
+        offsets.push_back(pos);
+    }
+    return newOffsets(env, offsets);
+}
+
+JNI_FUNC(void, Pdfium, buildIndex)(JNI_ARGS, jobject pfd, jlong stamp) {
+    int count;
+    {
+        Mutex::Autolock lock(sLibraryLock);
+        DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+        count = document != NULL ? document->pages.getCount() : 0;
+    }
+    IndexBuilder builder;
+    std::vector<unsigned short> text;
+    for (int i = 0; i < count; i++) {
+        if (!loadPageText(env, thiz, i, text)) {
+            jniThrowExceptionFmt(env, "java/io/IOException", "cannot load page %d", i);
+            return;
+        }
+        builder.add(i, text.data(), text.size());
+    }
+    if (!builder.write(getFD(env, pfd), (uint64_t) stamp))
+        jniThrowExceptionFmt(env, "java/io/IOException", "write failed: %s", strerror(errno));
+}
+
+JNI_FUNC(jint, Pdfium, getVersion)(JNI_ARGS) {
+    Mutex::Autolock lock(sLibraryLock);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(thiz, sJni.pdfiumHandle);
+    FPDF_DOCUMENT doc = document != NULL ? document->doc : NULL;
+    int version = 0;
+    if (!FPDF_GetFileVersion(doc, &version))
+        return 0;
+    return version;
+}
+
+// Pdfium.META_KEYS, standard /Info keys (custom keys can not be enumerated through FPDF_GetMetaText)
+static const char *sMetaKeys[] = {"Title", "Author", "Subject", "Keywords", "Creator", "Producer",
+                                  "CreationDate", "ModDate"};
+
+#define META_COUNT (sizeof(sMetaKeys) / sizeof(sMetaKeys[0]))
+
+// Open document with plain pread loader (no mmap, no block cache, no page table) and read Info keys,
+// version, page count, permissions and first page size. Returns NULL if document can not be opened:
+// with IOException pending for empty or unreadable file, otherwise FPDF_GetLastError() holds the
+// reason. Must be called under sLibraryLock.
+static jobject describeDocument(JNIEnv *env, int fd, const char *password) {
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        jniThrowExceptionFmt(env, "java/io/IOException", "cannot stat file: %s", strerror(errno));
+        return NULL;
+    }
+    long fileLength = (long) st.st_size;
+    if (fileLength <= 0) {
+        jniThrowException(env, "java/io/IOException", "File is empty");
+        return NULL;
+    }
+
+    FPDF_FILEACCESS loader;
+    loader.m_FileLen = fileLength;
+    loader.m_Param = reinterpret_cast<void *>(intptr_t(fd));
+    loader.m_GetBlock = &getBlock;
+    FPDF_DOCUMENT doc = FPDF_LoadCustomDocument(&loader, password);
+    if (doc == NULL)
+        return NULL;
+
+    jclass string = env->FindClass("java/lang/String");
+    jobjectArray meta = env->NewObjectArray(META_COUNT, string, 0);
+    env->DeleteLocalRef(string);
+    std::vector<jbyte> buf;
+    for (size_t i = 0; i < META_COUNT; i++) {
+        unsigned long len = FPDF_GetMetaText(doc, sMetaKeys[i], NULL, 0);
+        if (len <= 2)
+            continue; // missing key
+        buf.resize(len);
+        FPDF_GetMetaText(doc, sMetaKeys[i], buf.data(), len);
+        jstring v = NewStringUTF16LE(env, buf.data(), len - 2);
+        env->SetObjectArrayElement(meta, i, v);
+        env->DeleteLocalRef(v);
+    }
+
+    int version = 0;
+    if (!FPDF_GetFileVersion(doc, &version))
+        version = 0;
+    int pages = FPDF_GetPageCount(doc);
+    jlong permissions = (jlong) FPDF_GetDocPermissions(doc);
+    FS_SIZEF size;
+    if (pages <= 0 || !FPDF_GetPageSizeByIndexF(doc, 0, &size))
+        size.width = size.height = 0;
+    FPDF_CloseDocument(doc);
+
+    jobject o = env->NewObject(sJni.description, sJni.descriptionInit, meta, version, pages,
+                               permissions, size.width, size.height);
+    env->DeleteLocalRef(meta);
+    return o;
+}
+
+JNI_FUNC(jobject, Pdfium, describe)(JNIEnv *env, jclass cls, jobject pfd, jstring password) {
+    if (pfd == NULL) {
+        jniThrowException(env, "java/lang/NullPointerException", NULL);
+        return NULL;
+    }
+    int fd = getFD(env, pfd);
+    if (env->ExceptionCheck())
+        return NULL;
+    const char *cpassword = password != NULL ? env->GetStringUTFChars(password, NULL) : NULL;
+    jobject o;
+    {
+        Mutex::Autolock lock(sLibraryLock);
+        initLibraryIfNeed();
+        o = describeDocument(env, fd, cpassword);
+        if (o == NULL && !env->ExceptionCheck())
+            throwOpenError(env);
+    }
+    if (cpassword != NULL)
+        env->ReleaseStringUTFChars(password, cpassword);
+    return o;
+}
+
+JNI_FUNC(jobjectArray, Pdfium, describeAll)(JNIEnv *env, jclass cls, jobjectArray pfds) {
+    int count = env->GetArrayLength(pfds);
+    jobjectArray ar = env->NewObjectArray(count, sJni.description, 0);
+    for (int i = 0; i < count; i++) {
+        jobject pfd = env->GetObjectArrayElement(pfds, i);
+        if (pfd == NULL)
+            continue;
+        int fd = getFD(env, pfd);
+        env->DeleteLocalRef(pfd);
+        jobject o;
+        unsigned long error = FPDF_ERR_SUCCESS;
+        {
+            Mutex::Autolock lock(sLibraryLock); // released between files
+            initLibraryIfNeed();
+            o = describeDocument(env, fd, NULL);
+            if (o == NULL && !env->ExceptionCheck())
+                error = FPDF_GetLastError(); // other threads may reset it once lock is released
+        }
+        if (o == NULL) {
+            if (env->ExceptionCheck()) {
+                env->ExceptionClear(); // empty or unreadable file
+                LOGD("Unable to describe document %d, file is empty or unreadable", i);
+            } else {
+                LOGD("Unable to describe document %d, error: %lu", i, error);
+            }
+            continue;
+        }
+        env->SetObjectArrayElement(ar, i, o);
+        env->DeleteLocalRef(o);
+    }
+    return ar;
+}
+
+JNI_FUNC(void, Pdfium_00024Page, render)(JNI_ARGS, jobject bitmap,
+                                         jint startX, jint startY,
+                                         jint drawSizeHor, jint drawSizeVer,
+                                         jint flags) {
+    Mutex::Autolock lock(sLibraryLock);
+    FPDF_PAGE page = getRenderPage(env, thiz);
+    if (page == NULL)
+        return;
+
+    BITMAP bm;
+    if (!lockBitmap(env, bitmap, &bm, flags))
+        return;
+
+    renderBitmap(page, &bm, startX, startY, drawSizeHor, drawSizeVer, flags);
+
+    unlockBitmap(env, bitmap, &bm, true);
+}
+
+static void renderMemory(JNIEnv *env, jobject thiz, void *addr, jlong capacity,
+                         jint width, jint height, jint stride, jint format,
+                         jint startX, jint startY, jint drawSizeHor, jint drawSizeVer, jint flags) {
+    BITMAP bm;
+    if (!initMemory(&bm, addr, capacity, width, height, stride, format, flags)) {
+        jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException",
+                             "Bad buffer: format %d, %dx%d, stride %d, capacity %lld", format,
+                             width, height, stride, (long long) capacity);
+        return;
+    }
+
+    Mutex::Autolock lock(sLibraryLock);
+    FPDF_PAGE page = getRenderPage(env, thiz);
+    if (page == NULL)
+        return;
+    renderBitmap(page, &bm, startX, startY, drawSizeHor, drawSizeVer, flags);
+}
+
+JNI_FUNC(void, Pdfium_00024Page, renderBuffer)(JNI_ARGS, jobject buffer,
+                                               jint width, jint height, jint stride, jint format,
+                                               jint startX, jint startY,
+                                               jint drawSizeHor, jint drawSizeVer,
+                                               jint flags) {
+    void *addr = env->GetDirectBufferAddress(buffer);
+    if (addr == NULL) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "Buffer must be direct");
+        return;
+    }
+    renderMemory(env, thiz, addr, env->GetDirectBufferCapacity(buffer), width, height, stride,
+                 format, startX, startY, drawSizeHor, drawSizeVer, flags);
+}
+
+JNI_FUNC(void, Pdfium_00024Page, renderAddress)(JNI_ARGS, jlong address,
+                                                jint width, jint height, jint stride, jint format,
+                                                jint startX, jint startY,
+                                                jint drawSizeHor, jint drawSizeVer,
+                                                jint flags) {
+    if (address == 0) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "Null address");
+        return;
+    }
+    renderMemory(env, thiz, (void *) address, -1, width, height, stride, format, startX, startY,
+                 drawSizeHor, drawSizeVer, flags);
+}
+
+// Read float[6] matrix (a, b, c, d, e, f) and optional float[4] clip (left, top, right, bottom),
+// null clip - whole target
+static bool getMatrix(JNIEnv *env, jfloatArray matrix, jfloatArray clip, BITMAP *bm, FS_MATRIX *m,
+                      FS_RECTF *c) {
+    if (matrix == NULL || env->GetArrayLength(matrix) < 6 ||
+        (clip != NULL && env->GetArrayLength(clip) < 4)) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                          "Matrix must have 6 values, clip 4 values");
+        return false;
+    }
+    float v[6];
+    env->GetFloatArrayRegion(matrix, 0, 6, v);
+    m->a = v[0];
+    m->b = v[1];
+    m->c = v[2];
+    m->d = v[3];
+    m->e = v[4];
+    m->f = v[5];
+    if (clip != NULL) {
+        env->GetFloatArrayRegion(clip, 0, 4, v);
+        c->left = v[0];
+        c->top = v[1];
+        c->right = v[2];
+        c->bottom = v[3];
+    } else {
+        c->left = 0;
+        c->top = 0;
+        c->right = bm->info.width;
+        c->bottom = bm->info.height;
+    }
+    return true;
+}
+
+JNI_FUNC(void, Pdfium_00024Page, renderMatrix)(JNI_ARGS, jobject bitmap, jfloatArray matrix,
+                                               jfloatArray clip, jint flags) {
+    Mutex::Autolock lock(sLibraryLock);
+    FPDF_PAGE page = getRenderPage(env, thiz);
+    if (page == NULL)
+        return;
+
+    BITMAP bm;
+    if (!lockBitmap(env, bitmap, &bm, flags))
+        return;
+
+    FS_MATRIX m;
+    FS_RECTF c;
+    if (getMatrix(env, matrix, clip, &bm, &m, &c))
+        renderMatrix(page, &bm, &m, &c, flags);
+
+    unlockBitmap(env, bitmap, &bm, true);
+}
+
+JNI_FUNC(void, Pdfium_00024Page, renderBufferMatrix)(JNI_ARGS, jobject buffer,
+                                                     jint width, jint height, jint stride,
+                                                     jint format, jfloatArray matrix,
+                                                     jfloatArray clip, jint flags) {
+    void *addr = env->GetDirectBufferAddress(buffer);
+    BITMAP bm;
+    if (addr == NULL || !initMemory(&bm, addr, env->GetDirectBufferCapacity(buffer), width, height,
+                                    stride, format, flags)) {
+        jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException",
+                             "Bad buffer: format %d, %dx%d, stride %d", format, width, height,
+                             stride);
+        return;
+    }
+
+    FS_MATRIX m;
+    FS_RECTF c;
+    if (!getMatrix(env, matrix, clip, &bm, &m, &c))
+        return;
+
+    Mutex::Autolock lock(sLibraryLock);
+    FPDF_PAGE page = getRenderPage(env, thiz);
+    if (page == NULL)
+        return;
+    renderMatrix(page, &bm, &m, &c, flags);
+}
+
+#define THUMB_EMBEDDED 1 // Pdfium.THUMB_EMBEDDED
+#define THUMB_RENDERED 2 // Pdfium.THUMB_RENDERED
+
+#define THUMB_FLAGS (FPDF_RENDER_LIMITEDIMAGECACHE | FPDF_RENDER_NO_SMOOTHTEXT | \
+                     FPDF_RENDER_NO_SMOOTHIMAGE | FPDF_RENDER_NO_SMOOTHPATH) // cheap preview render
+
+// Scale embedded page thumbnail (/Thumb) into whole target. Returns false if page has no thumbnail.
+// Must be called under sLibraryLock.
+static bool scaleThumbnail(FPDF_PAGE page, BITMAP *bm) {
+    FPDF_BITMAP thumb = FPDFPage_GetThumbnailAsBitmap(page);
+    if (thumb == NULL)
+        return false;
+
+    int format = FPDFBitmap_GetFormat(thumb);
+    int bpp = format == FPDFBitmap_Gray ? 1 : format == FPDFBitmap_BGR ? 3 : 4;
+    int thumbWidth = FPDFBitmap_GetWidth(thumb);
+    int thumbHeight = FPDFBitmap_GetHeight(thumb);
+    if (format == FPDFBitmap_Unknown || thumbWidth <= 0 || thumbHeight <= 0) {
+        FPDFBitmap_Destroy(thumb);
+        return false;
+    }
+
+    int width = bm->info.width;
+    int height = bm->info.height;
+    int stride = width * sizeof(rgb);
+    int bandHeight = allocBand(stride, height);
+    for (int top = 0; bandHeight > 0 && top < height; top += bandHeight) {
+        int rows = height - top < bandHeight ? height - top : bandHeight;
+        scaleToRgb(FPDFBitmap_GetBuffer(thumb), thumbWidth, thumbHeight, FPDFBitmap_GetStride(thumb),
+                   bpp, sBand, stride, width, height, top, rows);
+        convertBand(bm, stride, top, 0, width, rows);
+    }
+
+    FPDFBitmap_Destroy(thumb);
+    return bandHeight > 0;
+}
+
+// Fill target with embedded thumbnail or cheap low resolution render. Must be called under
+// sLibraryLock.
+static int renderThumbnail(FPDF_PAGE page, BITMAP *bm, int flags) {
+    if (scaleThumbnail(page, bm))
+        return THUMB_EMBEDDED;
+
+    fillWhite(bm);
+    renderBitmap(page, bm, 0, 0, bm->info.width, bm->info.height, flags | THUMB_FLAGS);
+    return THUMB_RENDERED;
+}
+
+JNI_FUNC(jint, Pdfium_00024Page, renderThumbnail)(JNI_ARGS, jobject bitmap, jint flags) {
+    Mutex::Autolock lock(sLibraryLock);
+    FPDF_PAGE page = getRenderPage(env, thiz);
+    if (page == NULL)
+        return 0;
+
+    BITMAP bm;
+    if (!lockBitmap(env, bitmap, &bm, flags))
+        return 0;
+
+    int ret = renderThumbnail(page, &bm, flags);
+
+    unlockBitmap(env, bitmap, &bm, true);
+    return ret;
+}
+
+JNI_FUNC(jint, Pdfium_00024Page, renderThumbnailBuffer)(JNI_ARGS, jobject buffer,
+                                                        jint width, jint height, jint stride,
+                                                        jint format, jint flags) {
+    void *addr = env->GetDirectBufferAddress(buffer);
+    BITMAP bm;
+    if (addr == NULL || !initMemory(&bm, addr, env->GetDirectBufferCapacity(buffer), width, height,
+                                    stride, format, flags)) {
+        jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException",
+                             "Bad buffer: format %d, %dx%d, stride %d", format, width, height,
+                             stride);
+        return 0;
+    }
+
+    Mutex::Autolock lock(sLibraryLock);
+    FPDF_PAGE page = getRenderPage(env, thiz);
+    if (page == NULL)
+        return 0;
+    return renderThumbnail(page, &bm, flags);
+}
+
+JNI_FUNC(jboolean, Pdfium_00024Page, renderProgressive)(JNI_ARGS, jobject bitmap,
+                                                        jint startX, jint startY,
+                                                        jint drawSizeHor, jint drawSizeVer,
+                                                        jint flags, jobject cancel,
+                                                        jint slice) {
+    PAUSE state;
+    state.env = env;
+    state.cancel = cancel;
+    state.slice = slice;
+
+    IFSDK_PAUSE pause;
+    pause.version = 1;
+    pause.NeedToPauseNow = &needToPauseNow;
+    pause.user = &state;
+
+    BITMAP bm;
+    FPDF_PAGE page;
+    DOCUMENT *document;
+    FPDF_BITMAP pdfBitmap;
+    int status;
+    {
+        Mutex::Autolock lock(sLibraryLock);
+        page = getRenderPage(env, thiz);
+        if (page == NULL || !lockBitmap(env, bitmap, &bm, flags))
+            return JNI_FALSE;
+        pdfBitmap = createBitmap(&bm, startX, startY, drawSizeHor, drawSizeVer);
+        if (pdfBitmap == NULL) {
+            unlockBitmap(env, bitmap, &bm, false);
+            return JNI_FALSE;
+        }
+        // render context lives in page until FPDF_RenderPage_Close(): Page.close() / Pdfium.close() wait
+        // and other renders of page throw until page is removed from rendering set
+        document = (DOCUMENT *) outerHandle(env, thiz);
+        document->rendering.insert(page);
+        state.deadline = uptimeMillis() + slice;
+        status = FPDF_RenderPageBitmap_Start(pdfBitmap, page,
+                                             startX, startY,
+                                             (int) drawSizeHor, (int) drawSizeVer,
+                                             0, (flags & ~RENDER_DITHER) | FPDF_REVERSE_BYTE_ORDER, &pause);
+    }
+
+    while (status == FPDF_RENDER_TOBECONTINUED && !isCancelled(&state)) {
+        sched_yield(); // let waiting threads grab the library lock between slices
+        Mutex::Autolock lock(sLibraryLock);
+        if ((FPDF_PAGE) env->GetLongField(thiz, sJni.pageHandle) != page ||
+            (DOCUMENT *) outerHandle(env, thiz) != document) { // can't happen while page is in rendering set
+            LOGE("Page handle changed during progressive render");
+            status = FPDF_RENDER_FAILED;
+            break;
+        }
+        state.deadline = uptimeMillis() + slice;
+        status = FPDF_RenderPage_Continue(page, &pause);
+    }
+
+    {
+        Mutex::Autolock lock(sLibraryLock);
+        FPDF_RenderPage_Close(page);
+        FPDFBitmap_Destroy(pdfBitmap);
+        document->rendering.erase(page);
+    }
+
+    bool done = status == FPDF_RENDER_DONE;
+    unlockBitmap(env, bitmap, &bm, done);
+    return (jboolean) done;
+}
+
+JNI_FUNC(void, Pdfium_00024Page, renderTiles)(JNI_ARGS, jobject bitmap,
+                                              jint startX, jint startY,
+                                              jint drawSizeHor, jint drawSizeVer,
+                                              jint flags) {
+    Mutex::Autolock lock(sLibraryLock);
+    FPDF_PAGE page = getRenderPage(env, thiz);
+    if (page == NULL)
+        return;
+
+    AndroidBitmapInfo info;
+    int ret;
+    if ((ret = AndroidBitmap_getInfo(env, bitmap, &info)) < 0) {
+        LOGE("Fetching bitmap info failed: %s", strerror(ret * -1));
+        return;
+    }
+
     if (info.format != ANDROID_BITMAP_FORMAT_RGBA_8888 &&
         info.format != ANDROID_BITMAP_FORMAT_RGB_565) {
         LOGE("Bitmap format must be RGBA_8888 or RGB_565");
@@ -439,105 +2159,257 @@ JNI_FUNC(void, Pdfium_00024Page, render)(JNI_ARGS, jobject bitmap,
         return;
     }
 
-    void *tmp;
-    int format;
-    int sourceStride;
-    if (info.format == ANDROID_BITMAP_FORMAT_RGB_565) {
-        tmp = malloc(canvasVerSize * canvasHorSize * sizeof(rgb));
-        sourceStride = canvasHorSize * sizeof(rgb);
-        format = FPDFBitmap_BGR;
-    } else {
-        tmp = addr;
-        sourceStride = info.stride;
-        format = FPDFBitmap_BGRA;
+    int bpp = info.format == ANDROID_BITMAP_FORMAT_RGB_565 ? 2 : 4;
+    bool dither = (flags & RENDER_DITHER) != 0;
+    flags |= FPDF_REVERSE_BYTE_ORDER;
+
+    TileKey key;
+    key.doc = (void *) outerHandle(env, thiz);
+    key.page = env->GetIntField(thiz, sJni.pageIndex);
+    key.width = drawSizeHor;
+    key.height = drawSizeVer;
+    key.flags = flags;
+    key.format = info.format;
+
+    // visible part of the page in page raster coordinates
+    int left = startX < 0 ? -startX : 0;
+    int top = startY < 0 ? -startY : 0;
+    int right = (int) info.width - startX;
+    if (right > drawSizeHor)
+        right = drawSizeHor;
+    int bottom = (int) info.height - startY;
+    if (bottom > drawSizeVer)
+        bottom = drawSizeVer;
+    float pageWidth = FPDF_GetPageWidthF(page);
+    float pageHeight = FPDF_GetPageHeightF(page);
+    if (left >= right || top >= bottom || pageWidth <= 0 || pageHeight <= 0) { // nothing to draw
+        AndroidBitmap_unlockPixels(env, bitmap);
+        return;
     }
 
-    FPDF_BITMAP pdfBitmap = FPDFBitmap_CreateEx(canvasHorSize, canvasVerSize, format, tmp,
-                                                sourceStride);
+    void *tmp = NULL;
+    for (int ty = top / TILE_SIZE; ty * TILE_SIZE < bottom; ty++) {
+        for (int tx = left / TILE_SIZE; tx * TILE_SIZE < right; tx++) {
+            int tileX = tx * TILE_SIZE;
+            int tileY = ty * TILE_SIZE;
+            int tileW = drawSizeHor - tileX < TILE_SIZE ? drawSizeHor - tileX : TILE_SIZE;
+            int tileH = drawSizeVer - tileY < TILE_SIZE ? drawSizeVer - tileY : TILE_SIZE;
+            key.x = tx;
+            key.y = ty;
+            uint8_t *data = sTileCache.get(key);
+            if (data == NULL) {
+                if (bpp == 2 && tmp == NULL && (tmp = malloc(TILE_SIZE * TILE_SIZE * sizeof(rgb))) == NULL) {
+                    LOGE("Unable to allocate tile buffer");
+                    continue;
+                }
+                data = sTileCache.put(key, tileW * tileH * bpp);
+                if (data == NULL) {
+                    LOGE("Unable to allocate tile");
+                    continue;
+                }
+                FPDF_BITMAP pdfBitmap;
+                if (bpp == 2) {
+                    pdfBitmap = FPDFBitmap_CreateEx(tileW, tileH, FPDFBitmap_BGR, tmp,
+                                                    tileW * sizeof(rgb));
+                } else {
+                    pdfBitmap = FPDFBitmap_CreateEx(tileW, tileH, FPDFBitmap_BGRA, data,
+                                                    tileW * bpp);
+                }
+                FPDFBitmap_FillRect(pdfBitmap, 0, 0, tileW, tileH, 0xFFFFFFFF); // White
+                // same viewport as renderBands, clipped to the tile so objects outside it are culled
+                FS_MATRIX m = {drawSizeHor / pageWidth, 0, 0, drawSizeVer / pageHeight, (float) -tileX,
+                               (float) -tileY};
+                FS_RECTF clip = {0, 0, (float) tileW, (float) tileH};
+                FPDF_RenderPageBitmapWithMatrix(pdfBitmap, page, &m, &clip, flags & ~RENDER_DITHER);
+                FPDFBitmap_Destroy(pdfBitmap);
+                if (bpp == 2)
+                    rgbTo565(tmp, tileW * sizeof(rgb), data, tileW * bpp, tileW, tileH, tileX, tileY, dither);
+            }
 
-    if (drawSizeHor < canvasHorSize || drawSizeVer < canvasVerSize) {
-        FPDFBitmap_FillRect(pdfBitmap, 0, 0, canvasHorSize, canvasVerSize, 0x848484FF); // Gray
+            // copy visible part of the tile
+            int x0 = tileX > left ? tileX : left;
+            int x1 = tileX + tileW < right ? tileX + tileW : right;
+            int y0 = tileY > top ? tileY : top;
+            int y1 = tileY + tileH < bottom ? tileY + tileH : bottom;
+            if (x1 <= x0 || y1 <= y0)
+                continue;
+            for (int y = y0; y < y1; y++) {
+                uint8_t *src = data + ((y - tileY) * tileW + (x0 - tileX)) * bpp;
+                uint8_t *dst = (uint8_t *) addr + (y + startY) * info.stride + (x0 + startX) * bpp;
+                memcpy(dst, src, (x1 - x0) * bpp);
+            }
+        }
     }
+    free(tmp);
 
-    int baseHorSize = (canvasHorSize < drawSizeHor) ? canvasHorSize : (int) drawSizeHor;
-    int baseVerSize = (canvasVerSize < drawSizeVer) ? canvasVerSize : (int) drawSizeVer;
-    int baseX = (startX < 0) ? 0 : (int) startX;
-    int baseY = (startY < 0) ? 0 : (int) startY;
-    flags |= FPDF_REVERSE_BYTE_ORDER;
+    AndroidBitmap_unlockPixels(env, bitmap);
+}
 
-    if (info.format == ANDROID_BITMAP_FORMAT_RGB_565) {
-        FPDFBitmap_FillRect(pdfBitmap, baseX, baseY, baseHorSize, baseVerSize, 0xFFFFFFFF); // White
-    }
+JNI_FUNC(void, Pdfium, setTileCacheSize)(JNIEnv *env, jclass cls, jlong bytes) {
+    Mutex::Autolock lock(sLibraryLock);
+    sTileCache.setBudget((size_t) bytes);
+}
 
-    FPDF_RenderPageBitmap(pdfBitmap, page,
-                          startX, startY,
-                          (int) drawSizeHor, (int) drawSizeVer,
-                          0, flags);
+JNI_FUNC(void, Pdfium, clearTileCache)(JNIEnv *env, jclass cls) {
+    Mutex::Autolock lock(sLibraryLock);
+    sTileCache.clear();
+}
 
-    if (info.format == ANDROID_BITMAP_FORMAT_RGB_565) {
-        rgbBitmapTo565(tmp, sourceStride, addr, &info);
-        free(tmp);
+// Page link table with web links, built on first use. Must be called without sLibraryLock held, caller
+// holds sCacheLock shared while using it. NULL if page is closed, with pending IllegalStateException if
+// document is closed.
+static LinkTable *getLinkTable(JNIEnv *env, jobject thiz) {
+    LinkTable *links = (LinkTable *) env->GetLongField(thiz, sJni.pageLinks);
+    if (links != NULL)
+        return links;
+    Mutex::Autolock lock(sLibraryLock);
+    links = (LinkTable *) env->GetLongField(thiz, sJni.pageLinks); // built by other thread
+    if (links != NULL)
+        return links;
+    FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, sJni.pageHandle);
+    if (page == NULL)
+        return NULL;
+    DOCUMENT *document = (DOCUMENT *) outerHandle(env, thiz);
+    if (document == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Document closed");
+        return NULL;
     }
+    links = new LinkTable(document->doc, page, true);
+    __sync_synchronize(); // publish table content before pointer
+    env->SetLongField(thiz, sJni.pageLinks, (jlong) links);
+    return links;
+}
 
-    AndroidBitmap_unlockPixels(env, bitmap);
+static jobject newLink(JNIEnv *env, LinkTable *links, int i) {
+    const LINK &l = links->get(i);
+    jstring s = 0;
+    if (!l.uri.empty())
+        s = env->NewString((const jchar *) l.uri.data(), l.uri.size());
+
+    jobject rect = 0;
+    FS_RECTF r;
+    if (links->getBounds(i, &r)) {
+        rect = env->NewObject(sJni.rect, sJni.rectInit, (int) floor(r.left), (int) ceil(r.top),
+                              (int) ceil(r.right), (int) floor(r.bottom));
+    }
+
+    jobject v = env->NewObject(sJni.link, sJni.linkInit, s, l.index, rect);
+
+    env->DeleteLocalRef(rect);
+    env->DeleteLocalRef(s);
+    return v;
+}
+
+static jobjectArray newLinks(JNIEnv *env, LinkTable *links, int type) {
+    std::vector<int> ids;
+    for (int i = 0; i < links->getCount(); i++) {
+        if (links->get(i).type == type)
+            ids.push_back(i);
+    }
+    jobjectArray result = env->NewObjectArray(ids.size(), sJni.link, 0);
+    for (size_t i = 0; i < ids.size(); i++) {
+        jobject v = newLink(env, links, ids[i]);
+        env->SetObjectArrayElement(result, i, v);
+        env->DeleteLocalRef(v);
+    }
+    return result;
 }
 
 JNI_FUNC(jobjectArray, Pdfium_00024Page, getLinks)(JNI_ARGS) {
+    RWLock::AutoRLock guard(sCacheLock);
+    LinkTable *links = (LinkTable *) env->GetLongField(thiz, sJni.pageLinks);
+    if (links != NULL) // built by getLinkAt() / getWebLinks()
+        return newLinks(env, links, LINK_ANNOT);
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, fid);
+    FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, sJni.pageHandle);
+    if (page == NULL)
+        return NULL;
+    DOCUMENT *document = (DOCUMENT *) outerHandle(env, thiz);
+    if (document == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Document closed");
+        return NULL;
+    }
+    LinkTable annots(document->doc, page, false); // no text page load
+    return newLinks(env, &annots, LINK_ANNOT);
+}
 
-    FPDF_DOCUMENT doc = (FPDF_DOCUMENT) outerHandle(env, thiz);
+JNI_FUNC(jobjectArray, Pdfium_00024Page, getWebLinks)(JNI_ARGS) {
+    RWLock::AutoRLock guard(sCacheLock);
+    LinkTable *links = getLinkTable(env, thiz);
+    if (links == NULL)
+        return NULL;
+    return newLinks(env, links, LINK_WEB);
+}
+
+JNI_FUNC(jobject, Pdfium_00024Page, getLinkAtPoint)(JNI_ARGS, jfloat x, jfloat y,
+                                                     jfloat tolerance) {
+    RWLock::AutoRLock guard(sCacheLock);
+    LinkTable *links = getLinkTable(env, thiz);
+    if (links == NULL)
+        return NULL;
+    int i = links->getLinkAt(x, y, tolerance);
+    if (i == -1)
+        return NULL;
+    return newLink(env, links, i);
+}
 
+// Annotation rectangles of page links in FPDFLink_Enumerate order, 4 floats per link (left, top, right,
+// bottom in page coordinates), zeros if link has no rectangle. Returns link count.
+static int linkRects(FPDF_PAGE page, std::vector<jfloat> &out) {
     int pos = 0;
-    std::vector<jlong> links;
+    int n = 0;
     FPDF_LINK link;
     while (FPDFLink_Enumerate(page, &pos, &link)) {
-        links.push_back(reinterpret_cast<jlong>(link));
+        FS_RECTF r;
+        if (!FPDFLink_GetAnnotRect(link, &r))
+            r.left = r.top = r.right = r.bottom = 0;
+        out.push_back(r.left);
+        out.push_back(r.top);
+        out.push_back(r.right);
+        out.push_back(r.bottom);
+        n++;
     }
+    return n;
+}
 
-    jclass linkClass = env->FindClass("com/github/axet/pdfium/Pdfium$Link");
-    jobjectArray result = env->NewObjectArray(links.size(), linkClass, 0);
-    for (int i = 0; i < links.size(); i++) {
-        int index = -1;
-        FPDF_DEST dest = FPDFLink_GetDest(doc, link);
-        if (dest != 0)
-            index = (int) FPDFDest_GetDestPageIndex(doc, dest);
-
-        jstring s = 0;
-        FPDF_ACTION action = FPDFLink_GetAction(link);
-        if (action != 0) {
-            size_t bufferLen = FPDFAction_GetURIPath(doc, action, NULL, 0);
-            if (bufferLen > 0) {
-                char *buf = (char *) malloc(bufferLen);
-                FPDFAction_GetURIPath(doc, action, buf, bufferLen);
-                s = env->NewStringUTF(buf);
-                free(buf);
-            }
-        }
-
-        jobject rect = 0;
-        FS_RECTF fsRectF;
-        if (FPDFLink_GetAnnotRect(link, &fsRectF)) {
-            jclass clazz = env->FindClass("android/graphics/Rect");
-            jmethodID constructorID = env->GetMethodID(clazz, "<init>", "(IIII)V");
-            rect = env->NewObject(clazz, constructorID, (int) floor(fsRectF.left),
-                                  (int) ceil(fsRectF.top), (int) ceil(fsRectF.right),
-                                  (int) floor(fsRectF.bottom));
-        }
+static jfloatArray newFloats(JNIEnv *env, const std::vector<jfloat> &v) {
+    jfloatArray ar = env->NewFloatArray(v.size());
+    env->SetFloatArrayRegion(ar, 0, v.size(), v.data());
+    return ar;
+}
 
-        jmethodID constructorID = env->GetMethodID(linkClass, "<init>",
-                                                   "(Ljava/lang/String;ILandroid/graphics/Rect;)V");
-        jobject v = env->NewObject(linkClass, constructorID, s, index, rect);
+// Copy packed floats into direct buffer (native byte order), as many as fit. Returns false if buffer
+// is not direct.
+static bool putFloats(JNIEnv *env, jobject buffer, const std::vector<jfloat> &v) {
+    void *addr = env->GetDirectBufferAddress(buffer);
+    if (addr == NULL) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "Buffer must be direct");
+        return false;
+    }
+    size_t n = env->GetDirectBufferCapacity(buffer) / sizeof(jfloat);
+    memcpy(addr, v.data(), (n < v.size() ? n : v.size()) * sizeof(jfloat));
+    return true;
+}
 
-        env->SetObjectArrayElement(result, i, v);
+JNI_FUNC(jfloatArray, Pdfium_00024Page, getLinkBounds)(JNI_ARGS) {
+    Mutex::Autolock lock(sLibraryLock);
+    FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, sJni.pageHandle);
+    std::vector<jfloat> rects;
+    linkRects(page, rects);
+    return newFloats(env, rects);
+}
 
-        env->DeleteLocalRef(v);
-        env->DeleteLocalRef(rect);
-        env->DeleteLocalRef(s);
+JNI_FUNC(jint, Pdfium_00024Page, getLinkBoundsBuffer)(JNI_ARGS, jobject buffer) {
+    std::vector<jfloat> rects;
+    int n;
+    {
+        Mutex::Autolock lock(sLibraryLock);
+        FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, sJni.pageHandle);
+        n = linkRects(page, rects);
     }
-    return result;
+    if (!putFloats(env, buffer, rects))
+        return 0;
+    return n;
 }
 
 JNI_FUNC(jobject, Pdfium_00024Page, toDevice)(JNI_ARGS, jint startX,
@@ -546,17 +2418,13 @@ JNI_FUNC(jobject, Pdfium_00024Page, toDevice)(JNI_ARGS, jint startX,
                                               jdouble pageX,
                                               jdouble pageY) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, fid);
+    FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, sJni.pageHandle);
 
     int deviceX, deviceY;
 
     FPDF_PageToDevice(page, startX, startY, sizeX, sizeY, rotate, pageX, pageY, &deviceX, &deviceY);
 
-    jclass clazz = env->FindClass("android/graphics/Point");
-    jmethodID constructorID = env->GetMethodID(clazz, "<init>", "(II)V");
-    return env->NewObject(clazz, constructorID, deviceX, deviceY);
+    return env->NewObject(sJni.point, sJni.pointInit, deviceX, deviceY);
 }
 
 JNI_FUNC(jobject, Pdfium_00024Page, toPage)(JNI_ARGS, jint startX,
@@ -565,65 +2433,64 @@ JNI_FUNC(jobject, Pdfium_00024Page, toPage)(JNI_ARGS, jint startX,
                                             jint deviceX,
                                             jint deviceY) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, fid);
+    FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, sJni.pageHandle);
 
     double pageX, pageY;
 
     FPDF_DeviceToPage(page, startX, startY, sizeX, sizeY, rotate, deviceX, deviceY, &pageX, &pageY);
 
-    jclass clazz = env->FindClass("android/graphics/Point");
-    jmethodID constructorID = env->GetMethodID(clazz, "<init>", "(II)V");
-    return env->NewObject(clazz, constructorID, (int) pageX, (int) pageY);
+    return env->NewObject(sJni.point, sJni.pointInit, (int) pageX, (int) pageY);
 }
 
 JNI_FUNC(jobject, Pdfium_00024Page, open)(JNI_ARGS) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, fid);
+    FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, sJni.pageHandle);
 
-    jclass clazz = env->FindClass("com/github/axet/pdfium/Pdfium$Text");
-    jmethodID constructorID = env->GetMethodID(clazz, "<init>", "()V");
-    jfieldID fidText = env->GetFieldID(clazz, "handle", "J");
-    jobject o = env->NewObject(clazz, constructorID);
+    jobject o = env->NewObject(sJni.text, sJni.textInit);
     FPDF_TEXTPAGE text = FPDFText_LoadPage((FPDF_PAGE) page);
-    env->SetLongField(o, fidText, (jlong) text);
+    env->SetLongField(o, sJni.textHandle, (jlong) text);
+    env->SetLongField(o, sJni.textPage, (jlong) page);
     return o;
 }
 
 JNI_FUNC(void, Pdfium_00024Page, close)(JNI_ARGS) {
-    Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, fid);
-    if (page != 0)
-        FPDF_ClosePage(page);
-    env->SetLongField(thiz, fid, 0);
+    LinkTable *links;
+    {
+        Mutex::Autolock lock(sLibraryLock);
+        FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, sJni.pageHandle);
+        if (page != 0) {
+            jobject outer = outerObject(env, thiz);
+            waitRendering(env, outer, page);
+            env->DeleteLocalRef(outer);
+            page = (FPDF_PAGE) env->GetLongField(thiz, sJni.pageHandle); // closed by other thread meanwhile
+        }
+        if (page != 0)
+            FPDF_ClosePage(page);
+        env->SetLongField(thiz, sJni.pageHandle, 0);
+        links = (LinkTable *) env->GetLongField(thiz, sJni.pageLinks); // lookups started later see NULL
+        env->SetLongField(thiz, sJni.pageLinks, 0);
+    }
+    if (links != NULL) {
+        RWLock::AutoWLock guard(sCacheLock); // wait for running getLinkAt() / getWebLinks()
+        delete links;
+    }
 }
 
 JNI_FUNC(jint, Pdfium_00024Text, getCount)(JNI_ARGS) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_TEXTPAGE text = (FPDF_TEXTPAGE) env->GetLongField(thiz, fid);
+    FPDF_TEXTPAGE text = (FPDF_TEXTPAGE) env->GetLongField(thiz, sJni.textHandle);
     return FPDFText_CountChars(text);
 }
 
 JNI_FUNC(jint, Pdfium_00024Text, getIndex)(JNI_ARGS, jint x, jint y) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_TEXTPAGE text = (FPDF_TEXTPAGE) env->GetLongField(thiz, fid);
+    FPDF_TEXTPAGE text = (FPDF_TEXTPAGE) env->GetLongField(thiz, sJni.textHandle);
     return FPDFText_GetCharIndexAtPos(text, x, y, 1, 1);
 }
 
 JNI_FUNC(jstring, Pdfium_00024Text, getText)(JNI_ARGS, jint start, jint count) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_TEXTPAGE text = (FPDF_TEXTPAGE) env->GetLongField(thiz, fid);
+    FPDF_TEXTPAGE text = (FPDF_TEXTPAGE) env->GetLongField(thiz, sJni.textHandle);
     jchar *str = (jchar *) malloc((count + 1) * sizeof(jchar));
     int len = FPDFText_GetText(text, start, count, str);
     if (len > 0) {
@@ -637,17 +2504,13 @@ JNI_FUNC(jstring, Pdfium_00024Text, getText)(JNI_ARGS, jint start, jint count) {
 
 JNI_FUNC(jobjectArray, Pdfium_00024Text, getBounds)(JNI_ARGS, jint start, jint count) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_TEXTPAGE text = (FPDF_TEXTPAGE) env->GetLongField(thiz, fid);
+    FPDF_TEXTPAGE text = (FPDF_TEXTPAGE) env->GetLongField(thiz, sJni.textHandle);
     int c = FPDFText_CountRects(text, start, count);
-    jclass rectCls = env->FindClass("android/graphics/Rect");
-    jmethodID constructorID = env->GetMethodID(rectCls, "<init>", "(IIII)V");
-    jobjectArray ar = env->NewObjectArray(c, rectCls, 0);
+    jobjectArray ar = env->NewObjectArray(c, sJni.rect, 0);
     for (int i = 0; i < c; i++) {
         double l, t, r, b;
         FPDFText_GetRect(text, i, &l, &t, &r, &b);
-        jobject v = env->NewObject(rectCls, constructorID, (int) floor(l), (int) ceil(t),
+        jobject v = env->NewObject(sJni.rect, sJni.rectInit, (int) floor(l), (int) ceil(t),
                                    (int) floor(r), (int) ceil(b));
         env->SetObjectArrayElement(ar, i, v);
         env->DeleteLocalRef(v);
@@ -655,70 +2518,329 @@ JNI_FUNC(jobjectArray, Pdfium_00024Text, getBounds)(JNI_ARGS, jint start, jint c
     return ar;
 }
 
+// Append text range rectangles, 4 floats per rect (left, top, right, bottom in page coordinates).
+// Returns rect count.
+static int textRects(FPDF_TEXTPAGE text, int start, int count, std::vector<jfloat> &out) {
+    int c = FPDFText_CountRects(text, start, count);
+    for (int i = 0; i < c; i++) {
+        double l, t, r, b;
+        FPDFText_GetRect(text, i, &l, &t, &r, &b);
+        out.push_back(l);
+        out.push_back(t);
+        out.push_back(r);
+        out.push_back(b);
+    }
+    return c > 0 ? c : 0;
+}
+
+JNI_FUNC(jfloatArray, Pdfium_00024Text, getBoundsPacked)(JNI_ARGS, jint start, jint count) {
+    Mutex::Autolock lock(sLibraryLock);
+    FPDF_TEXTPAGE text = (FPDF_TEXTPAGE) env->GetLongField(thiz, sJni.textHandle);
+    std::vector<jfloat> rects;
+    textRects(text, start, count, rects);
+    return newFloats(env, rects);
+}
+
+JNI_FUNC(jfloatArray, Pdfium_00024Text, getBoundsRanges)(JNI_ARGS, jintArray ranges) {
+    int len = env->GetArrayLength(ranges) / 2 * 2;
+    std::vector<jint> r(len);
+    env->GetIntArrayRegion(ranges, 0, len, r.data());
+
+    Mutex::Autolock lock(sLibraryLock);
+    FPDF_TEXTPAGE text = (FPDF_TEXTPAGE) env->GetLongField(thiz, sJni.textHandle);
+    std::vector<jfloat> rects;
+    for (int i = 0; i < len; i += 2) {
+        size_t pos = rects.size();
+        rects.push_back(0);
+        rects[pos] = textRects(text, r[i], r[i + 1], rects);
+    }
+    return newFloats(env, rects);
+}
+
+JNI_FUNC(jint, Pdfium_00024Text, getBoundsBuffer)(JNI_ARGS, jint start, jint count,
+                                                  jobject buffer) {
+    std::vector<jfloat> rects;
+    int n;
+    {
+        Mutex::Autolock lock(sLibraryLock);
+        FPDF_TEXTPAGE text = (FPDF_TEXTPAGE) env->GetLongField(thiz, sJni.textHandle);
+        n = textRects(text, start, count, rects);
+    }
+    if (!putFloats(env, buffer, rects))
+        return 0;
+    return n;
+}
+
 JNI_FUNC(jobject, Pdfium_00024Text, search)(JNI_ARGS, jstring str, jint flags, jint index) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_TEXTPAGE tp = (FPDF_TEXTPAGE) env->GetLongField(thiz, fid);
+    FPDF_TEXTPAGE tp = (FPDF_TEXTPAGE) env->GetLongField(thiz, sJni.textHandle);
 
     FPDF_WIDESTRING ss = GetStringUTF16LEChars(env, str);
     FPDF_SCHHANDLE search = FPDFText_FindStart(tp, ss, (unsigned long) flags, index);
     ReleaseStringUTF16LEChars(ss);
 
-    jclass searchClass = env->FindClass("com/github/axet/pdfium/Pdfium$Search");
-    jmethodID constructorID = env->GetMethodID(searchClass, "<init>", "()V");
-    jobject o = env->NewObject(searchClass, constructorID);
-    jfieldID fid2 = env->GetFieldID(searchClass, "handle", "J");
-    env->SetLongField(o, fid2, (jlong) search);
+    jobject o = env->NewObject(sJni.search, sJni.searchInit);
+    env->SetLongField(o, sJni.searchHandle, (jlong) search);
     return o;
 }
 
-JNI_FUNC(void, Pdfium_00024Text, close)(JNI_ARGS) {
+// Char box cache of text page, built on first use. Returned cache is immutable and used without
+// sLibraryLock, caller holds sCacheLock shared while using it.
+static CharCache *getCharCache(JNIEnv *env, jobject thiz) {
+    CharCache *cache = (CharCache *) env->GetLongField(thiz, sJni.textCache);
+    if (cache != NULL)
+        return cache;
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_TEXTPAGE text = (FPDF_TEXTPAGE) env->GetLongField(thiz, fid);
-    if (text != 0)
-        FPDFText_ClosePage(text);
-    env->SetLongField(thiz, fid, (jlong) 0);
+    cache = (CharCache *) env->GetLongField(thiz, sJni.textCache); // built by other thread
+    if (cache != NULL)
+        return cache;
+    FPDF_TEXTPAGE text = (FPDF_TEXTPAGE) env->GetLongField(thiz, sJni.textHandle);
+    FPDF_PAGE page = (FPDF_PAGE) env->GetLongField(thiz, sJni.textPage);
+    if (text == NULL || page == NULL)
+        return NULL;
+    cache = new CharCache(text, page);
+    __sync_synchronize(); // publish cache content before pointer
+    env->SetLongField(thiz, sJni.textCache, (jlong) cache);
+    return cache;
+}
+
+JNI_FUNC(jint, Pdfium_00024Text, getCharIndex)(JNI_ARGS, jfloat x, jfloat y, jfloat tolerance) {
+    RWLock::AutoRLock guard(sCacheLock);
+    CharCache *cache = getCharCache(env, thiz);
+    if (cache == NULL)
+        return -1;
+    return cache->getIndex(x, y, tolerance);
+}
+
+JNI_FUNC(jfloatArray, Pdfium_00024Text, getLineBounds)(JNI_ARGS, jint start, jint count) {
+    RWLock::AutoRLock guard(sCacheLock);
+    CharCache *cache = getCharCache(env, thiz);
+    if (cache == NULL)
+        return NULL;
+    std::vector<jfloat> rects;
+    cache->getLines(start, count, rects);
+    return newFloats(env, rects);
+}
+
+JNI_FUNC(jfloatArray, Pdfium_00024Text, select)(JNI_ARGS, jint startX, jint startY, jint sizeX,
+                                               jint sizeY, jint rotate, jfloat x1, jfloat y1,
+                                               jfloat x2, jfloat y2, jint flags) {
+    RWLock::AutoRLock guard(sCacheLock);
+    CharCache *cache = getCharCache(env, thiz);
+    if (cache == NULL)
+        return NULL;
+    MATRIX m = cache->getMatrix(startX, startY, sizeX, sizeY, rotate);
+    std::vector<jfloat> out;
+    if (!cache->select(m, x1, y1, x2, y2, flags, out))
+        return NULL;
+    return newFloats(env, out);
+}
+
+JNI_FUNC(void, Pdfium_00024Text, close)(JNI_ARGS) {
+    CharCache *cache;
+    {
+        Mutex::Autolock lock(sLibraryLock);
+        FPDF_TEXTPAGE text = (FPDF_TEXTPAGE) env->GetLongField(thiz, sJni.textHandle);
+        if (text != 0)
+            FPDFText_ClosePage(text);
+        env->SetLongField(thiz, sJni.textHandle, (jlong) 0);
+        cache = (CharCache *) env->GetLongField(thiz, sJni.textCache); // queries started later see NULL
+        env->SetLongField(thiz, sJni.textCache, (jlong) 0);
+    }
+    if (cache != NULL) {
+        RWLock::AutoWLock guard(sCacheLock); // wait for running getCharIndex() / getLineBounds() / select()
+        delete cache;
+    }
 }
 
 JNI_FUNC(jboolean, Pdfium_00024Search, next)(JNI_ARGS) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_SCHHANDLE search = (FPDF_SCHHANDLE) env->GetLongField(thiz, fid);
+    FPDF_SCHHANDLE search = (FPDF_SCHHANDLE) env->GetLongField(thiz, sJni.searchHandle);
     return (jboolean) FPDFText_FindNext(search);
 }
 
 JNI_FUNC(jboolean, Pdfium_00024Search, prev)(JNI_ARGS) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_SCHHANDLE search = (FPDF_SCHHANDLE) env->GetLongField(thiz, fid);
+    FPDF_SCHHANDLE search = (FPDF_SCHHANDLE) env->GetLongField(thiz, sJni.searchHandle);
     return (jboolean) FPDFText_FindPrev(search);
 }
 
 JNI_FUNC(jobject, Pdfium_00024Search, result)(JNI_ARGS) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_SCHHANDLE search = (FPDF_SCHHANDLE) env->GetLongField(thiz, fid);
-    jclass klass = env->FindClass("com/github/axet/pdfium/Pdfium$TextResult");
-    jmethodID constructorID = env->GetMethodID(klass, "<init>", "(II)V");
+    FPDF_SCHHANDLE search = (FPDF_SCHHANDLE) env->GetLongField(thiz, sJni.searchHandle);
     int s = FPDFText_GetSchResultIndex(search);
     int c = FPDFText_GetSchCount(search);
-    return env->NewObject(klass, constructorID, s, c);
+    return env->NewObject(sJni.textResult, sJni.textResultInit, s, c);
 }
 
 JNI_FUNC(void, Pdfium_00024Search, close)(JNI_ARGS) {
     Mutex::Autolock lock(sLibraryLock);
-    jclass cls = env->GetObjectClass(thiz);
-    jfieldID fid = env->GetFieldID(cls, "handle", "J");
-    FPDF_SCHHANDLE search = (FPDF_SCHHANDLE) env->GetLongField(thiz, fid);
+    FPDF_SCHHANDLE search = (FPDF_SCHHANDLE) env->GetLongField(thiz, sJni.searchHandle);
     if (search != 0)
         FPDFText_FindClose(search);
-    env->SetLongField(thiz, fid, (jlong) 0);
+    env->SetLongField(thiz, sJni.searchHandle, (jlong) 0);
+}
+
+// Index handle, NULL with pending IllegalStateException when index is closed
+static TextIndex *getTextIndex(JNIEnv *env, jobject thiz) {
+    TextIndex *index = (TextIndex *) env->GetLongField(thiz, sJni.indexHandle);
+    if (index == NULL)
+        jniThrowException(env, "java/lang/IllegalStateException", "Index closed");
+    return index;
+}
+
+JNI_FUNC(void, Pdfium_00024Index, open)(JNI_ARGS, jobject pfd) {
+    TextIndex *index = new TextIndex();
+    if (!index->open(getFD(env, pfd))) {
+        delete index;
+        jniThrowException(env, "java/io/IOException", "Bad index file");
+        return;
+    }
+    env->SetLongField(thiz, sJni.indexHandle, (jlong) index);
+}
+
+JNI_FUNC(jlong, Pdfium_00024Index, getStamp)(JNI_ARGS) {
+    TextIndex *index = getTextIndex(env, thiz);
+    if (index == NULL)
+        return 0;
+    return (jlong) index->getStamp();
+}
+
+JNI_FUNC(jint, Pdfium_00024Index, getPageCount)(JNI_ARGS) {
+    TextIndex *index = getTextIndex(env, thiz);
+    if (index == NULL)
+        return 0;
+    return index->getPageCount();
+}
+
+JNI_FUNC(jintArray, Pdfium_00024Index, find)(JNI_ARGS, jstring query, jint flags) {
+    TextIndex *index = getTextIndex(env, thiz);
+    if (index == NULL)
+        return NULL;
+    int len = env->GetStringLength(query);
+    std::vector<uint16_t> q(len);
+    env->GetStringRegion(query, 0, len, (jchar *) q.data());
+    std::vector<INDEXHIT> hits = index->find(q.data(), len, flags);
+    std::vector<jint> packed;
+    packed.reserve(hits.size() * 3);
+    for (size_t i = 0; i < hits.size(); i++) {
+        packed.push_back(hits[i].page);
+        packed.push_back(hits[i].index);
+        packed.push_back(hits[i].count);
+    }
+    jintArray ar = env->NewIntArray(packed.size());
+    env->SetIntArrayRegion(ar, 0, packed.size(), packed.data());
+    return ar;
+}
+
+JNI_FUNC(void, Pdfium_00024Index, close)(JNI_ARGS) {
+    TextIndex *index = (TextIndex *) env->GetLongField(thiz, sJni.indexHandle);
+    delete index;
+    env->SetLongField(thiz, sJni.indexHandle, (jlong) 0);
+}
+
+JNI_FUNC(void, Pdfium_00024Finder, open)(JNI_ARGS, jstring query, jint flags, jint first) {
+    Mutex::Autolock lock(sLibraryLock);
+    jobject outer = env->GetObjectField(thiz, sJni.finderOuter);
+    DOCUMENT *document = (DOCUMENT *) env->GetLongField(outer, sJni.pdfiumHandle);
+    env->DeleteLocalRef(outer);
+    if (document == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Document closed");
+        return;
+    }
+    FINDER *f = new FINDER();
+    int len = env->GetStringLength(query);
+    f->query.resize(len + 1, 0);
+    env->GetStringRegion(query, 0, len, (jchar *) f->query.data());
+    f->owner = document;
+    f->flags = flags;
+    f->index = first;
+    f->page = NULL;
+    f->text = NULL;
+    f->search = NULL;
+    document->finders.insert(f);
+    env->SetLongField(thiz, sJni.finderHandle, (jlong) f);
+}
+
+// Finder handle, NULL with pending IllegalStateException when finder is closed
+static FINDER *getFinder(JNIEnv *env, jobject thiz) {
+    FINDER *f = (FINDER *) env->GetLongField(thiz, sJni.finderHandle);
+    if (f == NULL)
+        jniThrowException(env, "java/lang/IllegalStateException", "Finder closed");
+    return f;
+}
+
+JNI_FUNC(jint, Pdfium_00024Finder, getPage)(JNI_ARGS) {
+    FINDER *f = getFinder(env, thiz);
+    if (f == NULL)
+        return 0;
+    return f->index;
+}
+
+JNI_FUNC(jfloatArray, Pdfium_00024Finder, next)(JNI_ARGS, jobject cancel, jint max) {
+    FINDER *f = getFinder(env, thiz);
+    if (f == NULL)
+        return NULL;
+    if (max < 1)
+        max = 1;
+
+    std::vector<jfloat> packed;
+    int hits = 0;
+    bool done = false;
+    while (!done && hits == 0) {
+        if (cancel != NULL && env->GetBooleanField(cancel, sJni.cancelCancelled))
+            break;
+        sched_yield(); // let waiting threads grab the library lock between pages
+        Mutex::Autolock lock(sLibraryLock);
+        DOCUMENT *document = f->owner;
+        if (document == NULL || f->index >= document->pages.getCount()) {
+            done = true;
+            break;
+        }
+        if (f->search == NULL) {
+            f->page = FPDF_LoadPage(document->doc, f->index);
+            f->text = f->page != NULL ? FPDFText_LoadPage(f->page) : NULL;
+            if (f->text != NULL)
+                f->search = FPDFText_FindStart(f->text, f->query.data(), (unsigned long) f->flags, 0);
+            if (f->search == NULL) { // page can't be loaded, skip it
+                closeFinderPage(f);
+                f->index++;
+                continue;
+            }
+        }
+        bool more = true;
+        while (hits < max && (more = FPDFText_FindNext(f->search))) {
+            int start = FPDFText_GetSchResultIndex(f->search);
+            int count = FPDFText_GetSchCount(f->search);
+            packed.push_back(f->index);
+            packed.push_back(start);
+            packed.push_back(count);
+            size_t pos = packed.size();
+            packed.push_back(0);
+            packed[pos] = textRects(f->text, start, count, packed);
+            hits++;
+        }
+        if (!more) { // page exhausted
+            closeFinderPage(f);
+            f->index++;
+        }
+    }
+
+    if (hits == 0)
+        return NULL;
+    return newFloats(env, packed);
+}
+
+JNI_FUNC(void, Pdfium_00024Finder, close)(JNI_ARGS) {
+    Mutex::Autolock lock(sLibraryLock);
+    FINDER *f = (FINDER *) env->GetLongField(thiz, sJni.finderHandle);
+    if (f == NULL)
+        return;
+    closeFinderPage(f);
+    if (f->owner != NULL)
+        f->owner->finders.erase(f);
+    delete f;
+    env->SetLongField(thiz, sJni.finderHandle, (jlong) 0);
 }
 
 } // extern C
@@ -0,0 +1,137 @@
+#include "links.hpp"
+
+#include <math.h>
+
+#include <fpdf_doc.h>
+#include <fpdf_text.h>
+
+LinkTable::LinkTable(FPDF_DOCUMENT doc, FPDF_PAGE page, bool web) {
+    int pos = 0;
+    FPDF_LINK link;
+    while (FPDFLink_Enumerate(page, &pos, &link)) {
+        LINK l;
+        l.type = LINK_ANNOT;
+        l.index = -1;
+        FPDF_DEST dest = FPDFLink_GetDest(doc, link);
+        if (dest != 0)
+            l.index = FPDFDest_GetDestPageIndex(doc, dest);
+        FPDF_ACTION action = FPDFLink_GetAction(link);
+        if (action != 0) {
+            unsigned long len = FPDFAction_GetURIPath(doc, action, NULL, 0);
+            if (len > 1) {
+                std::vector<char> buf(len);
+                FPDFAction_GetURIPath(doc, action, buf.data(), len);
+                for (unsigned long i = 0; i < len && buf[i] != 0; i++)
+                    l.uri.push_back((uint8_t) buf[i]); // 7-bit ASCII
+            }
+        }
+        l.rect = owner.size();
+        l.rects = 0;
+        FS_RECTF r;
+        if (FPDFLink_GetAnnotRect(link, &r)) {
+            owner.push_back(links.size());
+            addRect(r.left, fminf(r.bottom, r.top), r.right, fmaxf(r.bottom, r.top));
+            l.rects = 1;
+        }
+        links.push_back(l);
+    }
+    annots = links.size();
+
+    FPDF_TEXTPAGE text = web ? FPDFText_LoadPage(page) : NULL;
+    FPDF_PAGELINK pl = text != NULL ? FPDFLink_LoadWebLinks(text) : NULL;
+    if (pl != NULL) {
+        int count = FPDFLink_CountWebLinks(pl);
+        for (int i = 0; i < count; i++) {
+            LINK l;
+            l.type = LINK_WEB;
+            l.index = -1;
+            int len = FPDFLink_GetURL(pl, i, NULL, 0); // units, including terminator
+            if (len > 1) {
+                l.uri.resize(len);
+                FPDFLink_GetURL(pl, i, (unsigned short *) l.uri.data(), len);
+                l.uri.resize(len - 1);
+            }
+            l.rect = owner.size();
+            l.rects = 0;
+            int n = FPDFLink_CountRects(pl, i);
+            for (int k = 0; k < n; k++) {
+                double rl, rt, rr, rb;
+                if (!FPDFLink_GetRect(pl, i, k, &rl, &rt, &rr, &rb))
+                    continue;
+                owner.push_back(links.size());
+                addRect(rl, rb, rr, rt);
+                l.rects++;
+            }
+            links.push_back(l);
+        }
+        FPDFLink_CloseWebLinks(pl);
+    }
+    if (text != NULL)
+        FPDFText_ClosePage(text);
+
+    grid.build(left.size(), left.data(), bottom.data(), right.data(), top.data(), LINKS_CELL_RECTS);
+}
+
+void LinkTable::addRect(float l, float b, float r, float t) {
+    left.push_back(l);
+    bottom.push_back(b);
+    right.push_back(r);
+    top.push_back(t);
+}
+
+int LinkTable::getCount() {
+    return links.size();
+}
+
+const LINK &LinkTable::get(int i) {
+    return links[i];
+}
+
+bool LinkTable::getBounds(int i, FS_RECTF *r) {
+    const LINK &l = links[i];
+    if (l.rects == 0)
+        return false;
+    r->left = left[l.rect];
+    r->bottom = bottom[l.rect];
+    r->right = right[l.rect];
+    r->top = top[l.rect];
+    for (int k = l.rect + 1; k < l.rect + l.rects; k++) {
+        r->left = fminf(r->left, left[k]);
+        r->bottom = fminf(r->bottom, bottom[k]);
+        r->right = fmaxf(r->right, right[k]);
+        r->top = fmaxf(r->top, top[k]);
+    }
+    return true;
+}
+
+int LinkTable::getLinkAt(float x, float y, float tolerance) {
+    int x0, y0, x1, y1;
+    grid.range(x - tolerance, y - tolerance, x + tolerance, y + tolerance, &x0, &y0, &x1, &y1);
+    int best = -1;
+    float bestDistance = 0;
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            for (const int *k = grid.begin(cx, cy); k != grid.end(cx, cy); k++) {
+                int i = *k;
+                float dx = x < left[i] ? left[i] - x : x > right[i] ? x - right[i] : 0;
+                float dy = y < bottom[i] ? bottom[i] - y : y > top[i] ? y - top[i] : 0;
+                if (dx > tolerance || dy > tolerance)
+                    continue;
+                float d = dx * dx + dy * dy;
+                int id = owner[i];
+                bool better;
+                if (best == -1 || d != bestDistance)
+                    better = best == -1 || d < bestDistance;
+                else if ((id < annots) != (best < annots))
+                    better = id < annots;
+                else
+                    better = id < annots ? id > best : id < best;
+                if (better) {
+                    best = id;
+                    bestDistance = d;
+                }
+            }
+        }
+    }
+    return best;
+}
@@ -0,0 +1,58 @@
+#ifndef _LINKS_HPP_
+#define _LINKS_HPP_
+
+#include <stdint.h>
+#include <vector>
+
+#include <fpdfview.h>
+
+#include "grid.hpp"
+
+#define LINKS_CELL_RECTS 2 // average link rects per grid cell
+
+#define LINK_ANNOT 0 // link annotation (FPDFLink_Enumerate)
+#define LINK_WEB 1 // url detected in page text (FPDFLink_LoadWebLinks)
+
+typedef struct {
+    int type; // LINK_ANNOT / LINK_WEB
+    int index; // destination page index, -1 if none
+    std::vector<uint16_t> uri; // UTF-16, empty if none
+    int rect; // first rect
+    int rects; // rect count
+} LINK;
+
+// Immutable per page table of annotation and web links with grid spatial index over link rects (page
+// coordinates). Built once under sLibraryLock, then queried without any lock.
+class LinkTable {
+public:
+    // must be called under sLibraryLock, web loads page text to detect web links
+    LinkTable(FPDF_DOCUMENT doc, FPDF_PAGE page, bool web);
+
+    int getCount();
+
+    const LINK &get(int i);
+
+    // union of link rects, false if link has no rects
+    bool getBounds(int i, FS_RECTF *r);
+
+    // link under point (rect within tolerance), -1 if none. Nearest rect wins, on tie annotations win over
+    // web links and topmost (last enumerated) annotation wins.
+    int getLinkAt(float x, float y, float tolerance);
+
+private:
+    void addRect(float l, float b, float r, float t);
+
+    std::vector<LINK> links; // annotation links first, in FPDFLink_Enumerate order, then web links
+    int annots;
+
+    // rects, structure of arrays
+    std::vector<float> left;
+    std::vector<float> bottom;
+    std::vector<float> right;
+    std::vector<float> top;
+    std::vector<int> owner; // link of rect
+
+    SpatialGrid grid;
+};
+
+#endif
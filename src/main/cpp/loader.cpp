@@ -0,0 +1,134 @@
+#include "loader.hpp"
+#include "log.hpp"
+
+extern "C" {
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+}
+
+#include <vector>
+
+FileLoader::FileLoader(int fd, size_t length, size_t budget, PREAD readAt) : hits(0), misses(0),
+                                                                              bytesRead(0), reads(0),
+                                                                              fd(fd), readAt(readAt),
+                                                                              length(length),
+                                                                              budget(budget), bytes(0),
+                                                                              next(0), window(1) {
+    access.m_FileLen = length;
+    access.m_Param = this;
+    access.m_GetBlock = &getBlock;
+}
+
+FileLoader::~FileLoader() {
+    trim(0);
+}
+
+FPDF_FILEACCESS *FileLoader::getAccess() {
+    return &access;
+}
+
+void FileLoader::setBudget(size_t b) {
+    budget = b;
+    trim(budget);
+}
+
+int FileLoader::getBlock(void *param, unsigned long position, unsigned char *outBuffer,
+                         unsigned long size) {
+    FileLoader *loader = (FileLoader *) param;
+    return loader->read(position, outBuffer, size) ? 1 : 0;
+}
+
+bool FileLoader::read(size_t position, uint8_t *out, size_t size) {
+    if (position + size > length)
+        return false;
+    while (size > 0) {
+        size_t index = position / LOADER_BLOCK;
+        size_t offset = position - index * LOADER_BLOCK;
+        Block *block = fetch(index);
+        if (block == NULL || offset >= block->size)
+            return false;
+        size_t n = block->size - offset < size ? block->size - offset : size;
+        memcpy(out, block->data + offset, n);
+        out += n;
+        position += n;
+        size -= n;
+    }
+    return true;
+}
+
+FileLoader::Block *FileLoader::fetch(size_t index) {
+    std::map<size_t, LRU::iterator>::iterator it = blocks.find(index);
+    if (it != blocks.end()) {
+        hits++;
+        if (index == next)
+            next = index + 1;
+        lru.splice(lru.begin(), lru, it->second);
+        return &*it->second;
+    }
+    misses++;
+
+    // grow read-ahead window while reader is sequential, reset on seek
+    size_t max = budget / LOADER_BLOCK / 2;
+    if (max > LOADER_READAHEAD)
+        max = LOADER_READAHEAD;
+    if (max < 1)
+        max = 1;
+    if (index == next)
+        window = window * 2 < max ? window * 2 : max;
+    else
+        window = 1;
+
+    size_t count = 1;
+    size_t last = (length + LOADER_BLOCK - 1) / LOADER_BLOCK;
+    while (count < window && index + count < last && blocks.find(index + count) == blocks.end())
+        count++;
+
+    size_t position = index * LOADER_BLOCK;
+    size_t size = count * LOADER_BLOCK;
+    if (position + size > length)
+        size = length - position;
+    std::vector<uint8_t> buf(size);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t r = readAt(fd, &buf[done], size - done, position + done);
+        reads++;
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0) {
+            LOGE("Cannot read from file descriptor. Error:%d", errno);
+            return NULL;
+        }
+        done += r;
+    }
+    bytesRead += size;
+
+    trim(budget > size ? budget - size : 0);
+    LRU::iterator pos = lru.begin(); // requested block goes first in LRU, prefetched follow it in order
+    for (size_t i = 0; i < count; i++) {
+        size_t off = i * LOADER_BLOCK;
+        Block block = {index + i, NULL, size - off < LOADER_BLOCK ? size - off : LOADER_BLOCK};
+        block.data = (uint8_t *) malloc(block.size);
+        if (block.data == NULL)
+            return NULL;
+        memcpy(block.data, &buf[off], block.size);
+        pos = lru.insert(pos, block);
+        blocks[block.index] = pos;
+        pos++;
+        bytes += block.size;
+    }
+    next = index + 1;
+    return &*blocks[index];
+}
+
+void FileLoader::trim(size_t b) {
+    while (bytes > b && !lru.empty()) {
+        LRU::iterator last = lru.end();
+        last--;
+        bytes -= last->size;
+        free(last->data);
+        blocks.erase(last->index);
+        lru.erase(last);
+    }
+}
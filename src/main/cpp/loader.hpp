@@ -0,0 +1,67 @@
+#ifndef _LOADER_HPP_
+#define _LOADER_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <list>
+#include <map>
+
+#include <unistd.h>
+
+#include <fpdfview.h>
+
+#define LOADER_BLOCK 16384 // cache block size, multiple of memory page size
+#define LOADER_READAHEAD 32 // max blocks prefetched by single read
+
+typedef ssize_t (*PREAD)(int fd, void *buf, size_t count, off_t offset);
+
+// FPDF_FILEACCESS backend reading file descriptor through LRU block cache. Detects sequential access and
+// prefetches ahead with growing window. Not thread safe, pdfium calls it under sLibraryLock.
+class FileLoader {
+public:
+    // readAt replaces pread(), tests use it to simulate slow storage
+    FileLoader(int fd, size_t length, size_t budget, PREAD readAt = &pread);
+
+    ~FileLoader();
+
+    FPDF_FILEACCESS *getAccess();
+
+    void setBudget(size_t budget);
+
+    // block cache counters
+    long long hits;
+    long long misses;
+    long long bytesRead;
+    long long reads; // pread syscalls
+
+private:
+    struct Block {
+        size_t index;
+        uint8_t *data;
+        size_t size;
+    };
+
+    typedef std::list<Block> LRU;
+
+    static int getBlock(void *param, unsigned long position, unsigned char *outBuffer,
+                        unsigned long size);
+
+    bool read(size_t position, uint8_t *out, size_t size);
+
+    Block *fetch(size_t index);
+
+    void trim(size_t budget);
+
+    int fd;
+    PREAD readAt;
+    size_t length;
+    size_t budget;
+    size_t bytes; // cached bytes
+    FPDF_FILEACCESS access;
+    LRU lru; // front is most recently used
+    std::map<size_t, LRU::iterator> blocks;
+    size_t next; // block expected by sequential reader
+    size_t window; // current read-ahead window in blocks
+};
+
+#endif
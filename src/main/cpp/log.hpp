@@ -0,0 +1,24 @@
+#ifndef _LOG_HPP_
+#define _LOG_HPP_
+
+#define LOG_TAG "jniPdfium"
+
+#ifdef __ANDROID__
+
+#include <android/log.h>
+
+#define LOGI(...)   __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...)   __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGD(...)   __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+#else // host build of platform independent modules (tests, benchmarks)
+
+#include <stdio.h>
+
+#define LOGI(...)   (fprintf(stderr, LOG_TAG ": " __VA_ARGS__), fputc('\n', stderr))
+#define LOGE(...)   LOGI(__VA_ARGS__)
+#define LOGD(...)   LOGI(__VA_ARGS__)
+
+#endif
+
+#endif
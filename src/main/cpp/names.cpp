@@ -0,0 +1,87 @@
+#include "names.hpp"
+
+#include <math.h>
+
+#include <fpdf_doc.h>
+
+NameTable::NameTable() : labelsMapped(0), destsLoaded(false) {
+}
+
+const std::u16string &NameTable::getLabel(FPDF_DOCUMENT doc, int page) {
+    if ((size_t) page >= resolved.size()) {
+        labels.resize(page + 1);
+        resolved.resize(page + 1, false);
+    }
+    if (!resolved[page]) {
+        resolved[page] = true;
+        unsigned long len = FPDF_GetPageLabel(doc, page, NULL, 0); // bytes, UTF-16LE with terminator
+        if (len > 2) {
+            std::vector<char16_t> buf(len / 2);
+            FPDF_GetPageLabel(doc, page, buf.data(), len);
+            labels[page].assign(buf.data(), len / 2 - 1);
+        }
+    }
+    return labels[page];
+}
+
+bool NameTable::mapNextLabel(FPDF_DOCUMENT doc, int count) {
+    if (labelsMapped >= count)
+        return false;
+    int page = labelsMapped++;
+    const std::u16string &label = getLabel(doc, page);
+    if (!label.empty())
+        labelPages.insert(std::make_pair(label, page)); // keeps first page for duplicated labels
+    return true;
+}
+
+void NameTable::loadDests(FPDF_DOCUMENT doc) {
+    if (destsLoaded)
+        return;
+    destsLoaded = true;
+    int count = FPDF_CountNamedDests(doc);
+    std::vector<char16_t> buf;
+    for (int i = 0; i < count; i++) {
+        long len = 0;
+        FPDF_GetNamedDest(doc, i, NULL, &len); // bytes, UTF-16LE with terminator
+        if (len <= 2)
+            continue;
+        buf.resize(len / 2);
+        FPDF_DEST dest = FPDF_GetNamedDest(doc, i, buf.data(), &len);
+        if (dest == NULL || len <= 2)
+            continue;
+
+        NAMEDDEST d;
+        d.page = FPDFDest_GetDestPageIndex(doc, dest);
+        d.x = d.y = d.zoom = NAN;
+        FPDF_BOOL hasX, hasY, hasZoom;
+        FS_FLOAT x, y, zoom;
+        if (FPDFDest_GetLocationInPage(dest, &hasX, &hasY, &hasZoom, &x, &y, &zoom)) {
+            if (hasX)
+                d.x = x;
+            if (hasY)
+                d.y = y;
+            if (hasZoom)
+                d.zoom = zoom;
+        }
+        dests.insert(std::make_pair(std::u16string(buf.data(), len / 2 - 1), d));
+    }
+}
+
+int NameTable::findLabel(const std::u16string &label) {
+    std::unordered_map<std::u16string, int>::iterator i = labelPages.find(label);
+    if (i == labelPages.end())
+        return -1;
+    return i->second;
+}
+
+bool NameTable::findDest(const std::u16string &name, NAMEDDEST *dest) {
+    std::unordered_map<std::u16string, NAMEDDEST>::iterator i = dests.find(name);
+    if (i == dests.end())
+        return false;
+    *dest = i->second;
+    return true;
+}
+
+int NameTable::getDestCount() {
+    return dests.size();
+}
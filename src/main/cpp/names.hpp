@@ -0,0 +1,53 @@
+#ifndef _NAMES_HPP_
+#define _NAMES_HPP_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fpdfview.h>
+
+#define DEST_STRIDE 4 // page, x, y, zoom (NaN if not set)
+
+typedef struct {
+    int page;
+    float x;
+    float y;
+    float zoom;
+} NAMEDDEST;
+
+// Page labels (/PageLabels) and named destinations (/Dests, /Names /Dests) of document, under sLibraryLock.
+// Labels are read by FPDF_GetPageLabel, which resolves the number tree without loading pages but walks back
+// to the start of page range, so labels are resolved on demand page by page and reverse map grows with them.
+// Destinations are loaded once on first use.
+class NameTable {
+public:
+    NameTable();
+
+    // label by page index (0 .. page count - 1), empty if none. Resolved on first request, then cached.
+    const std::u16string &getLabel(FPDF_DOCUMENT doc, int page);
+
+    // add label of next unmapped page to reverse map, false if all count pages are mapped. Mapping whole
+    // document is quadratic on long label ranges, callers release sLibraryLock between pages.
+    bool mapNextLabel(FPDF_DOCUMENT doc, int count);
+
+    void loadDests(FPDF_DOCUMENT doc);
+
+    // first page with label among mapped pages, -1 if none
+    int findLabel(const std::u16string &label);
+
+    // false if name not found
+    bool findDest(const std::u16string &name, NAMEDDEST *dest);
+
+    int getDestCount();
+
+private:
+    int labelsMapped; // pages 0 .. labelsMapped - 1 are in labelPages
+    bool destsLoaded;
+    std::vector<std::u16string> labels; // by page, valid where resolved
+    std::vector<bool> resolved;
+    std::unordered_map<std::u16string, int> labelPages;
+    std::unordered_map<std::u16string, NAMEDDEST> dests;
+};
+
+#endif
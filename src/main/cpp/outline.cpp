@@ -0,0 +1,148 @@
+#include "outline.hpp"
+
+#include <algorithm>
+
+bool OutlineTree::visit(FPDF_BOOKMARK bm, FPDF_BOOKMARK parent, int index) {
+    std::map<FPDF_BOOKMARK, OUTLINENODE>::iterator i = nodes.find(bm);
+    if (i != nodes.end())
+        return i->second.parent == parent && i->second.index == index;
+    OUTLINENODE n = {parent, index};
+    nodes[bm] = n;
+    return true;
+}
+
+void OutlineTree::walk(FPDF_DOCUMENT doc, std::vector<BOOKMARK> &list) {
+    typedef struct {
+        FPDF_BOOKMARK parent;
+        FPDF_BOOKMARK bm; // next sibling to visit
+        int index;
+    } LEVEL;
+    std::vector<LEVEL> stack; // one entry per open level, no recursion on deep trees
+    LEVEL top = {NULL, FPDFBookmark_GetFirstChild(doc, NULL), 0};
+    stack.push_back(top);
+    while (!stack.empty()) {
+        LEVEL &l = stack.back();
+        FPDF_BOOKMARK bm = l.bm;
+        if (bm == NULL || !visit(bm, l.parent, l.index)) {
+            stack.pop_back();
+            continue;
+        }
+        l.bm = FPDFBookmark_GetNextSibling(doc, bm);
+        l.index++;
+        BOOKMARK b = {bm, (int) stack.size() - 1, -1};
+        FPDF_DEST dest = FPDFBookmark_GetDest(doc, bm);
+        if (dest != 0)
+            b.page = FPDFDest_GetDestPageIndex(doc, dest);
+        list.push_back(b);
+        LEVEL sub = {bm, FPDFBookmark_GetFirstChild(doc, bm), 0};
+        stack.push_back(sub); // l is invalid after push
+    }
+}
+
+bool OutlineTree::children(FPDF_DOCUMENT doc, FPDF_BOOKMARK parent, FPDF_BOOKMARK after, int max,
+                           std::vector<FPDF_BOOKMARK> &out, bool *more) {
+    FPDF_BOOKMARK bm;
+    int index;
+    if (after != NULL) {
+        std::map<FPDF_BOOKMARK, OUTLINENODE>::iterator i = nodes.find(after);
+        if (i == nodes.end())
+            return false;
+        parent = i->second.parent;
+        index = i->second.index + 1;
+        bm = FPDFBookmark_GetNextSibling(doc, after);
+    } else {
+        if (parent != NULL && nodes.find(parent) == nodes.end())
+            return false;
+        index = 0;
+        bm = FPDFBookmark_GetFirstChild(doc, parent);
+    }
+    *more = false;
+    while (bm != NULL && visit(bm, parent, index)) {
+        if ((int) out.size() >= max) {
+            *more = true;
+            break;
+        }
+        out.push_back(bm);
+        bm = FPDFBookmark_GetNextSibling(doc, bm);
+        index++;
+    }
+    return true;
+}
+
+bool OutlineTree::hasChildren(FPDF_DOCUMENT doc, FPDF_BOOKMARK bm) {
+    FPDF_BOOKMARK first = FPDFBookmark_GetFirstChild(doc, bm);
+    return first != NULL && visit(first, bm, 0); // back edge to visited node is no child
+}
+
+static bool sectionLess(const SECTION &a, const SECTION &b) {
+    return a.start < b.start || (a.start == b.start && a.id < b.id);
+}
+
+static int buildMax(std::vector<SECTION> &s, std::vector<int> &max, int lo, int hi) {
+    if (lo >= hi)
+        return -1;
+    int mid = (lo + hi) / 2;
+    int m = s[mid].end;
+    int l = buildMax(s, max, lo, mid); // depth log n
+    int r = buildMax(s, max, mid + 1, hi);
+    max[mid] = std::max(m, std::max(l, r));
+    return max[mid];
+}
+
+SectionIndex::SectionIndex(const std::vector<BOOKMARK> &list, int pages) {
+    std::vector<int> open; // ids of entries waiting for section end, levels ascending
+    for (size_t i = 0; i <= list.size(); i++) {
+        if (i < list.size())
+            entries.push_back(list[i].bm);
+        bool last = i == list.size();
+        if (!last && (list[i].page < 0 || list[i].page >= pages))
+            continue; // unresolved destination, does not start or end sections
+        int level = last ? -1 : list[i].level;
+        int page = last ? pages : list[i].page;
+        while (!open.empty() && list[open.back()].level >= level) {
+            const BOOKMARK &b = list[open.back()];
+            SECTION s = {b.page, page > b.page ? page : b.page + 1, b.level, open.back()};
+            sections.push_back(s);
+            open.pop_back();
+        }
+        if (!last)
+            open.push_back(i);
+    }
+    std::sort(sections.begin(), sections.end(), sectionLess);
+    maxEnd.resize(sections.size());
+    buildMax(sections, maxEnd, 0, sections.size());
+}
+
+void SectionIndex::find(int lo, int hi, int page, std::vector<int> &ids) {
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (maxEnd[mid] <= page)
+            return; // every section in range ends before page
+        find(lo, mid, page, ids);
+        if (sections[mid].start > page)
+            return; // right half starts after page
+        if (page < sections[mid].end)
+            ids.push_back(sections[mid].id);
+        lo = mid + 1;
+    }
+}
+
+void SectionIndex::find(int page, std::vector<int> &ids) {
+    find(0, sections.size(), page, ids);
+    std::sort(ids.begin(), ids.end());
+}
+
+int SectionIndex::findInner(int page) {
+    std::vector<int> ids;
+    find(0, sections.size(), page, ids);
+    int best = -1;
+    for (size_t i = 0; i < ids.size(); i++) {
+        if (best == -1 || ids[i] > best)
+            best = ids[i]; // nested sections: later entry is deeper
+    }
+    return best;
+}
+
+FPDF_BOOKMARK SectionIndex::get(int id) {
+    return entries[id];
+}
@@ -0,0 +1,76 @@
+#ifndef _OUTLINE_HPP_
+#define _OUTLINE_HPP_
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+#include <fpdf_doc.h>
+
+#define OUTLINE_STRIDE 3 // page, flags, title end
+#define OUTLINE_CHILDREN 1 // Pdfium.OUTLINE_CHILDREN, node has children
+
+typedef struct {
+    FPDF_BOOKMARK bm;
+    int level;
+    int page; // destination page index, -1 if none
+} BOOKMARK;
+
+typedef struct {
+    FPDF_BOOKMARK parent; // NULL for top level
+    int index; // sibling position
+} OUTLINENODE;
+
+// Document outline traversal. Every visited node is registered with its parent and sibling position, a node
+// reached again at another position (malformed /First /Next loops) ends that sibling run. Registered nodes
+// are the only handles accepted back from Java. Must be used under sLibraryLock.
+class OutlineTree {
+public:
+    // whole outline in depth first order, iterative
+    void walk(FPDF_DOCUMENT doc, std::vector<BOOKMARK> &list);
+
+    // up to max children of parent (NULL: top level) following after (NULL: from first child). Returns
+    // false if parent or after is not a known node, *more set if siblings remain.
+    bool children(FPDF_DOCUMENT doc, FPDF_BOOKMARK parent, FPDF_BOOKMARK after, int max,
+                  std::vector<FPDF_BOOKMARK> &out, bool *more);
+
+    // true if children() of known node bm returns at least one node
+    bool hasChildren(FPDF_DOCUMENT doc, FPDF_BOOKMARK bm);
+
+private:
+    bool visit(FPDF_BOOKMARK bm, FPDF_BOOKMARK parent, int index);
+
+    std::map<FPDF_BOOKMARK, OUTLINENODE> nodes;
+};
+
+typedef struct {
+    int start; // first page
+    int end; // past last page
+    int level;
+    int id; // position in OutlineTree::walk() order
+} SECTION;
+
+// Page to outline entries index. Entry section spans from its page up to the page of next entry on same or
+// upper level (or document end). Intervals sorted by start with implicit balanced tree of max ends, stabbing
+// query takes O(log n + hits). Immutable after build.
+class SectionIndex {
+public:
+    SectionIndex(const std::vector<BOOKMARK> &list, int pages);
+
+    // ids of entries containing page, outermost first
+    void find(int page, std::vector<int> &ids);
+
+    // innermost entry containing page, -1 if none
+    int findInner(int page);
+
+    FPDF_BOOKMARK get(int id);
+
+private:
+    void find(int lo, int hi, int page, std::vector<int> &ids);
+
+    std::vector<FPDF_BOOKMARK> entries; // by id
+    std::vector<SECTION> sections;
+    std::vector<int> maxEnd; // max end over sections[lo, hi) stored at (lo + hi) / 2
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "pages.hpp"
+
+extern "C" {
+#include <math.h>
+}
+
+#include <fpdf_edit.h>
+
+using namespace android;
+
+PageTable::PageTable() : count(0) {
+}
+
+void PageTable::init(int c) {
+    Mutex::Autolock l(lock);
+    count = c;
+    data.assign((size_t) c * PAGEINFO_STRIDE, 0);
+    windows.assign((c + PAGEINFO_WINDOW - 1) / PAGEINFO_WINDOW, 0);
+    boxes.assign(c, 0);
+}
+
+int PageTable::getCount() {
+    Mutex::Autolock l(lock);
+    return count;
+}
+
+void PageTable::load(FPDF_DOCUMENT doc, int first, int n) {
+    for (int w = first / PAGEINFO_WINDOW; w * PAGEINFO_WINDOW < first + n; w++) {
+        {
+            Mutex::Autolock l(lock);
+            if (windows[w])
+                continue;
+        }
+        int start = w * PAGEINFO_WINDOW;
+        int end = start + PAGEINFO_WINDOW < count ? start + PAGEINFO_WINDOW : count;
+        std::vector<FS_SIZEF> sizes(end - start);
+        for (int i = start; i < end; i++) {
+            if (!FPDF_GetPageSizeByIndexF(doc, i, &sizes[i - start])) {
+                sizes[i - start].width = 0;
+                sizes[i - start].height = 0;
+            }
+        }
+        Mutex::Autolock l(lock);
+        for (int i = start; i < end; i++) {
+            float *info = &data[(size_t) i * PAGEINFO_STRIDE];
+            info[0] = sizes[i - start].width;
+            info[1] = sizes[i - start].height;
+            if (!boxes[i]) {
+                info[2] = -1;
+                info[3] = info[4] = info[5] = info[6] = NAN;
+            }
+        }
+        windows[w] = 1;
+    }
+}
+
+bool PageTable::loadBoxes(FPDF_DOCUMENT doc, int i) {
+    {
+        Mutex::Autolock l(lock);
+        if (boxes[i])
+            return false;
+    }
+    float info[5] = {-1, NAN, NAN, NAN, NAN}; // rotation, bounding box left, bottom, right, top
+    FPDF_PAGE page = FPDF_LoadPage(doc, i);
+    if (page != NULL) {
+        info[0] = FPDFPage_GetRotation(page);
+        FS_RECTF box;
+        if (FPDF_GetPageBoundingBox(page, &box)) {
+            info[1] = box.left;
+            info[2] = box.bottom;
+            info[3] = box.right;
+            info[4] = box.top;
+        }
+        FPDF_ClosePage(page);
+    }
+    Mutex::Autolock l(lock);
+    std::copy(info, info + 5, data.begin() + (size_t) i * PAGEINFO_STRIDE + 2);
+    boxes[i] = 1;
+    return true;
+}
+
+bool PageTable::get(int first, int n, int flags, float *out) {
+    Mutex::Autolock l(lock);
+    for (int w = first / PAGEINFO_WINDOW; w * PAGEINFO_WINDOW < first + n; w++) {
+        if (!windows[w])
+            return false;
+    }
+    if (flags & PAGEINFO_BOXES) {
+        for (int i = first; i < first + n; i++) {
+            if (!boxes[i])
+                return false;
+        }
+    }
+    std::copy(data.begin() + (size_t) first * PAGEINFO_STRIDE,
+              data.begin() + (size_t) (first + n) * PAGEINFO_STRIDE, out);
+    return true;
+}
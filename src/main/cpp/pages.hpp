@@ -0,0 +1,42 @@
+#ifndef _PAGES_HPP_
+#define _PAGES_HPP_
+
+#include <stdint.h>
+#include <vector>
+#include <utils/Mutex.h>
+
+#include <fpdfview.h>
+
+#define PAGEINFO_STRIDE 7 // width, height, rotation, bounding box left, bottom, right, top
+#define PAGEINFO_WINDOW 256 // page sizes loaded at once
+#define PAGEINFO_BOXES 1 // Pdfium.PAGEINFO_BOXES, rotation and bounding boxes requested (requires page loading)
+
+// Document page geometry table. Sizes are loaded lazily by windows, boxes page by page, both under
+// sLibraryLock. Queried under own lock only.
+class PageTable {
+public:
+    PageTable();
+
+    void init(int count);
+
+    int getCount();
+
+    // load missing size windows covering pages range, must be called under sLibraryLock
+    void load(FPDF_DOCUMENT doc, int first, int count);
+
+    // load rotation and bounding box of single page, must be called under sLibraryLock. Returns false
+    // if already loaded
+    bool loadBoxes(FPDF_DOCUMENT doc, int page);
+
+    // copy cached pages info into out (PAGEINFO_STRIDE floats per page), false if range not loaded yet
+    bool get(int first, int count, int flags, float *out);
+
+private:
+    android::Mutex lock;
+    int count;
+    std::vector<float> data;
+    std::vector<uint8_t> windows; // per window sizes loaded flags
+    std::vector<uint8_t> boxes; // per page boxes loaded flags
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "tiles.hpp"
+
+extern "C" {
+#include <stdlib.h>
+}
+
+bool TileKey::operator<(const TileKey &o) const {
+    if (doc != o.doc)
+        return doc < o.doc;
+    if (page != o.page)
+        return page < o.page;
+    if (width != o.width)
+        return width < o.width;
+    if (height != o.height)
+        return height < o.height;
+    if (y != o.y)
+        return y < o.y;
+    if (x != o.x)
+        return x < o.x;
+    if (flags != o.flags)
+        return flags < o.flags;
+    return format < o.format;
+}
+
+TileCache::TileCache(size_t budget) : budget(budget), bytes(0) {
+}
+
+TileCache::~TileCache() {
+    clear();
+}
+
+uint8_t *TileCache::get(const TileKey &key) {
+    std::map<TileKey, LRU::iterator>::iterator it = map.find(key);
+    if (it == map.end())
+        return NULL;
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->data;
+}
+
+uint8_t *TileCache::put(const TileKey &key, size_t size) {
+    std::map<TileKey, LRU::iterator>::iterator it = map.find(key);
+    if (it != map.end())
+        remove(it->second);
+    trim(budget > size ? budget - size : 0);
+    Tile tile = {key, (uint8_t *) malloc(size), size};
+    if (tile.data == NULL)
+        return NULL;
+    lru.push_front(tile);
+    map[key] = lru.begin();
+    bytes += size;
+    return tile.data;
+}
+
+void TileCache::evict(void *doc) {
+    LRU::iterator it = lru.begin();
+    while (it != lru.end()) {
+        LRU::iterator next = it;
+        next++;
+        if (it->key.doc == doc)
+            remove(it);
+        it = next;
+    }
+}
+
+void TileCache::setBudget(size_t b) {
+    budget = b;
+    trim(budget);
+}
+
+void TileCache::clear() {
+    trim(0);
+}
+
+void TileCache::trim(size_t b) {
+    while (bytes > b && !lru.empty()) {
+        LRU::iterator last = lru.end();
+        last--;
+        remove(last);
+    }
+}
+
+void TileCache::remove(LRU::iterator it) {
+    map.erase(it->key);
+    bytes -= it->size;
+    free(it->data);
+    lru.erase(it);
+}
@@ -0,0 +1,63 @@
+#ifndef _TILES_HPP_
+#define _TILES_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <list>
+#include <map>
+
+#define TILE_SIZE 256
+
+struct TileKey {
+    void *doc;
+    int page;
+    int width; // rendered page size, scale bucket
+    int height;
+    int x; // tile column / row
+    int y;
+    int flags;
+    int format;
+
+    bool operator<(const TileKey &o) const;
+};
+
+// LRU cache of rendered tiles limited by total pixel bytes. Not thread safe, guarded by sLibraryLock.
+class TileCache {
+public:
+    TileCache(size_t budget);
+
+    ~TileCache();
+
+    // returns tile pixels and marks tile as most recently used, NULL if not cached
+    uint8_t *get(const TileKey &key);
+
+    // allocates tile pixels, evicting least recently used tiles to fit budget. Returned buffer is valid
+    // until next put() call, even when tile itself exceeds budget
+    uint8_t *put(const TileKey &key, size_t size);
+
+    void evict(void *doc);
+
+    void setBudget(size_t budget);
+
+    void clear();
+
+private:
+    struct Tile {
+        TileKey key;
+        uint8_t *data;
+        size_t size;
+    };
+
+    typedef std::list<Tile> LRU;
+
+    void trim(size_t budget);
+
+    void remove(LRU::iterator it);
+
+    LRU lru; // front is most recently used
+    std::map<TileKey, LRU::iterator> map;
+    size_t budget;
+    size_t bytes;
+};
+
+#endif
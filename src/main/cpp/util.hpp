@@ -6,14 +6,9 @@ extern "C" {
     #include <stdlib.h>
 }
 
-#include <android/log.h>
+#include "log.hpp"
 
 #define JNI_FUNC(retType, bindClass, name)  JNIEXPORT retType JNICALL Java_com_github_axet_pdfium_##bindClass##_##name
 #define JNI_ARGS    JNIEnv *env, jobject thiz
 
-#define LOG_TAG "jniPdfium"
-#define LOGI(...)   __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
-#define LOGE(...)   __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-#define LOGD(...)   __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
-
 #endif
\ No newline at end of file
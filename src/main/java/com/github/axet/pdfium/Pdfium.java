@@ -1,11 +1,14 @@
 package com.github.axet.pdfium;
 
 import android.graphics.Bitmap;
+import android.graphics.Matrix;
 import android.graphics.Point;
 import android.graphics.Rect;
+import android.graphics.RectF;
 
 import java.io.FileDescriptor;
 import java.io.IOException;
+import java.nio.ByteBuffer;
 
 public class Pdfium {
     private static final String TAG = Pdfium.class.getName();
@@ -13,6 +16,42 @@ public class Pdfium {
     public static final int FPDF_MATCHCASE = 0x00000001;  // If not set, it will not match case by default.
     public static final int FPDF_MATCHWHOLEWORD = 0x00000002; // If not set, it will not match the whole word by default.
 
+    public static final int OPEN_MMAP = 1; // Map file into memory instead of pread per block request.
+    public static final int OPEN_CACHE = 2; // Read file through LRU block cache with sequential read-ahead (slow storage).
+
+    public static final int FORMAT_GRAY = 1; // 8 bit luminance
+    public static final int FORMAT_BGR = 2; // 3 bytes per pixel, blue first
+    public static final int FORMAT_BGRA = 4; // 4 bytes per pixel, blue first
+    public static final int FORMAT_RGBA = 5; // 4 bytes per pixel, red first (Bitmap.Config.ARGB_8888 layout)
+    public static final int FORMAT_RGB_565 = 6; // 16 bit, Bitmap.Config.RGB_565 layout
+
+    public static final int THUMB_EMBEDDED = 1; // Thumbnail taken from embedded page /Thumb image.
+    public static final int THUMB_RENDERED = 2; // Thumbnail rendered with cheap flags (no smoothing, limited image cache).
+
+    public static final int TEXT_UTF16 = 0; // UTF-16LE text, no BOM
+    public static final int TEXT_UTF8 = 1; // UTF-8 text
+
+    public static final int INDEX_PREFIX = 1; // Last query word matches any indexed word starting with it.
+
+    public static final int SELECT_WORD = 1; // Extend selection to word boundaries.
+    public static final int SELECT_LINE = 2; // Extend selection to whole lines.
+
+    public static final int OUTLINE_STRIDE = 3; // page, flags, title end
+    public static final int OUTLINE_CHILDREN = 1; // Outline node has children, expand with getOutline(handle, max).
+
+    public static final int DEST_STRIDE = 4; // page, x, y, zoom (NaN if not set)
+
+    public static final int PDF_DATA_ERROR = -1;
+    public static final int PDF_DATA_NOTAVAIL = 0;
+    public static final int PDF_DATA_AVAIL = 1;
+
+    public static final int PDF_LINEARIZATION_UNKNOWN = -1;
+    public static final int PDF_NOT_LINEARIZED = 0;
+    public static final int PDF_LINEARIZED = 1;
+
+    public static final int PAGEINFO_STRIDE = 7; // width, height, rotation, bounding box left, bottom, right, top
+    public static final int PAGEINFO_BOXES = 1; // Load pages to get rotation and bounding box (crop box intersected with media box).
+
     public static final String META_TITLE = "Title";
     public static final String META_AUTHOR = "Author";
     public static final String META_SUBJECT = "Subject";
@@ -22,6 +61,9 @@ public class Pdfium {
     public static final String META_CREATIONDATE = "CreationDate";
     public static final String META_MODDATE = "ModDate";
 
+    public static final String[] META_KEYS = {META_TITLE, META_AUTHOR, META_SUBJECT, META_KEYWORDS, META_CREATOR,
+            META_PRODUCER, META_CREATIONDATE, META_MODDATE}; // Description.meta order
+
     public static final int FPDF_ANNOT = 0x01; // Set if annotations are to be rendered.
     public static final int FPDF_LCD_TEXT = 0x02; // Set if using text rendering optimized for LCD display.
     public static final int FPDF_NO_NATIVETEXT = 0x04; // Don't use the native text output available on some platforms
@@ -34,6 +76,7 @@ public class Pdfium {
     public static final int FPDF_RENDER_NO_SMOOTHTEXT = 0x1000; // Set to disable anti-aliasing on text.
     public static final int FPDF_RENDER_NO_SMOOTHIMAGE = 0x2000; // Set to disable anti-aliasing on images.
     public static final int FPDF_RENDER_NO_SMOOTHPATH = 0x4000; // Set to disable anti-aliasing on paths.
+    public static final int RENDER_DITHER = 0x01000000; // Ordered dither for RGB_565 bitmaps, fewer banding on gradients.
 
     private long handle;
 
@@ -48,8 +91,69 @@ public class Pdfium {
 
     public static native void FPDF_DestroyLibrary();
 
+    /**
+     * Set memory budget in bytes for {@link Page#renderTiles(Bitmap, int, int, int, int, int)} cache. Default 32MB.
+     */
+    public static native void setTileCacheSize(long bytes);
+
+    public static native void clearTileCache();
+
+    /**
+     * Read document properties without creating {@link Pdfium} object: document is opened with plain pread loader,
+     * queried and closed in single locked call.
+     */
+    public static native Description describe(FileDescriptor fd, String password) throws IOException;
+
+    /**
+     * Describe many documents (library scan) in single call, library lock is released between files.
+     *
+     * @return description per descriptor, null for documents which can not be opened (empty, damaged, encrypted)
+     */
+    public static Description[] describe(FileDescriptor[] fds) {
+        return describeAll(fds);
+    }
+
+    static native Description[] describeAll(FileDescriptor[] fds);
+
+    /**
+     * Document wide search session, see {@link #find(String, int, int)}. Pages are scanned natively, library lock
+     * is released between pages. Must be closed before document.
+     */
+    public class Finder {
+        private long handle;
+
+        Finder(String query, int flags, int first) {
+            open(query, flags, first);
+        }
+
+        native void open(String query, int flags, int first);
+
+        /**
+         * Scan pages until hits found. Returns as soon as page with hits is scanned or max hits collected, search
+         * continues from the same place on next call.
+         *
+         * @param cancel token to stop scanning, can be null
+         * @return packed hits: page index, char index, char count, rect count n, then n rects (left, top, right,
+         * bottom in page coordinates). null when no more pages or cancelled
+         */
+        public native float[] next(Cancel cancel, int max);
+
+        /**
+         * Page scanned next, progress indicator.
+         */
+        public native int getPage();
+
+        /**
+         * Release current page. Closing document releases it too and next() returns null after that. Other methods
+         * throw {@link IllegalStateException} after close.
+         */
+        public native void close();
+    }
+
     public class Page {
         private long handle;
+        private int index;
+        private long links; // native link table
 
         public native Text open();
 
@@ -73,10 +177,159 @@ public class Pdfium {
         public native void render(Bitmap bitmap, int startX, int startY, int drawSizeX, int drawSizeY, int flags);
 
         /**
-         * Get all links from given page
+         * Render page fragment on {@link Bitmap} progressively. Library lock is released between slices, so
+         * heavy pages do not block other documents / threads. Page {@link #close()} and {@link Pdfium#close()} wait
+         * until call returns, other renders of this page throw {@link IllegalStateException} meanwhile.
+         *
+         * @param cancel token to abandon rendering (user scrolled away), can be null
+         * @param slice  time budget in milliseconds per locked slice, 0 - render until done or cancelled
+         * @return true if page fully rendered, false if rendering cancelled or failed (bitmap content undefined)
+         */
+        public boolean render(Bitmap bitmap, int startX, int startY, int drawSizeX, int drawSizeY, int flags, Cancel cancel, int slice) {
+            return renderProgressive(bitmap, startX, startY, drawSizeX, drawSizeY, flags, cancel, slice);
+        }
+
+        /**
+         * Render page fragment on {@link Bitmap} using fixed size tiles. Tiles are cached between calls
+         * (see {@link #setTileCacheSize(long)}), so panning renders only newly exposed tiles. Tiles are keyed by
+         * page, drawSizeX / drawSizeY (scale), flags and bitmap format. Page is rendered on white background,
+         * bitmap area outside the page is left untouched.
+         */
+        public native void renderTiles(Bitmap bitmap, int startX, int startY, int drawSizeX, int drawSizeY, int flags);
+
+        /**
+         * Render page fragment into direct {@link ByteBuffer}, pixels are written starting from buffer address
+         * (position ignored). Formats without alpha ({@link #FORMAT_GRAY}, {@link #FORMAT_BGR},
+         * {@link #FORMAT_RGB_565}) get white page background, alpha formats keep buffer background.
+         * <p>
+         * No {@link Bitmap} is created or locked, but the native library still requires Android runtime (it links
+         * android and jnigraphics), so this path can not be used from a host JVM.
+         *
+         * @param stride row size in bytes
+         * @param format one of FORMAT_*
+         */
+        public void render(ByteBuffer buffer, int width, int height, int stride, int format, int startX, int startY, int drawSizeX, int drawSizeY, int flags) {
+            renderBuffer(buffer, width, height, stride, format, startX, startY, drawSizeX, drawSizeY, flags);
+        }
+
+        /**
+         * Render page fragment into native memory. Memory must hold stride * height bytes.
+         *
+         * @see #render(ByteBuffer, int, int, int, int, int, int, int, int, int)
+         */
+        public void render(long address, int width, int height, int stride, int format, int startX, int startY, int drawSizeX, int drawSizeY, int flags) {
+            renderAddress(address, width, height, stride, format, startX, startY, drawSizeX, drawSizeY, flags);
+        }
+
+        /**
+         * Render page viewport on {@link Bitmap} through affine matrix. Bitmap holds only visible rectangle at any
+         * zoom / rotation, no page size canvas needed.
+         *
+         * @param matrix page to bitmap transform {a, b, c, d, e, f}: x' = a * x + c * y + e, y' = b * x + d * y + f,
+         *               page coordinates are points with top left origin (page as rendered at 1:1 with no rotation)
+         * @param clip   bitmap area to render {left, top, right, bottom}, null - whole bitmap. Pixels outside clip
+         *               are left untouched
+         */
+        public void render(Bitmap bitmap, float[] matrix, float[] clip, int flags) {
+            renderMatrix(bitmap, matrix, clip, flags);
+        }
+
+        /**
+         * Render page viewport on {@link Bitmap} through {@link Matrix} (page points to bitmap pixels).
+         *
+         * @see #render(Bitmap, float[], float[], int)
+         */
+        public void render(Bitmap bitmap, Matrix matrix, RectF clip, int flags) {
+            renderMatrix(bitmap, toMatrix(matrix), clip == null ? null : new float[]{clip.left, clip.top, clip.right, clip.bottom}, flags);
+        }
+
+        /**
+         * Render page viewport into direct {@link ByteBuffer}.
+         *
+         * @see #render(Bitmap, float[], float[], int)
+         * @see #render(ByteBuffer, int, int, int, int, int, int, int, int, int)
+         */
+        public void render(ByteBuffer buffer, int width, int height, int stride, int format, float[] matrix, float[] clip, int flags) {
+            renderBufferMatrix(buffer, width, height, stride, format, matrix, clip, flags);
+        }
+
+        /**
+         * Fill whole {@link Bitmap} with page preview: embedded page thumbnail scaled to bitmap size when present,
+         * low resolution render with cheap flags otherwise. Bitmap should have page aspect ratio.
+         *
+         * @return {@link #THUMB_EMBEDDED}, {@link #THUMB_RENDERED} or 0 if bitmap can't be locked
+         */
+        public native int renderThumbnail(Bitmap bitmap, int flags);
+
+        /**
+         * Fill whole direct {@link ByteBuffer} with page preview.
+         *
+         * @see #renderThumbnail(Bitmap, int)
+         */
+        public int renderThumbnail(ByteBuffer buffer, int width, int height, int stride, int format, int flags) {
+            return renderThumbnailBuffer(buffer, width, height, stride, format, flags);
+        }
+
+        native int renderThumbnailBuffer(ByteBuffer buffer, int width, int height, int stride, int format, int flags);
+
+        native void renderMatrix(Bitmap bitmap, float[] matrix, float[] clip, int flags);
+
+        native void renderBufferMatrix(ByteBuffer buffer, int width, int height, int stride, int format, float[] matrix, float[] clip, int flags);
+
+        native void renderBuffer(ByteBuffer buffer, int width, int height, int stride, int format, int startX, int startY, int drawSizeX, int drawSizeY, int flags);
+
+        native void renderAddress(long address, int width, int height, int stride, int format, int startX, int startY, int drawSizeX, int drawSizeY, int flags);
+
+        native boolean renderProgressive(Bitmap bitmap, int startX, int startY, int drawSizeX, int drawSizeY, int flags, Cancel cancel, int slice);
+
+        /**
+         * Get all links from given page (link annotations, page text is not loaded)
          */
         public native Link[] getLinks();
 
+        /**
+         * Get urls detected in page text (not link annotations), {@link Link#index} is -1. Link bounds are union
+         * of text line rectangles.
+         */
+        public native Link[] getWebLinks();
+
+        /**
+         * Hit test annotation and web links in one call. Page links are indexed on first call, following
+         * calls do not take library lock.
+         *
+         * @param x page coordinates, see {@link #toPage(int, int, int, int, int, int, int)}
+         * @param y page coordinates
+         * @return link under point or nearest link within tolerance (annotations win over web links), null if none
+         */
+        public Link getLinkAt(float x, float y, float tolerance) {
+            return getLinkAtPoint(x, y, tolerance);
+        }
+
+        public Link getLinkAt(float x, float y) {
+            return getLinkAtPoint(x, y, 0);
+        }
+
+        native Link getLinkAtPoint(float x, float y, float tolerance);
+
+        /**
+         * Get link rectangles without allocating objects per link, same order as {@link #getLinks()}.
+         *
+         * @return 4 values per link: left, top, right, bottom in page coordinates (zeros if link has no rectangle)
+         */
+        public native float[] getLinkBounds();
+
+        /**
+         * Write link rectangles into direct {@link ByteBuffer} as native order floats (use
+         * {@code buffer.order(ByteOrder.nativeOrder()).asFloatBuffer()}), as many as fit.
+         *
+         * @return link count, grow buffer and repeat if it does not fit
+         */
+        public int getLinkBounds(ByteBuffer buffer) {
+            return getLinkBoundsBuffer(buffer);
+        }
+
+        native int getLinkBoundsBuffer(ByteBuffer buffer);
+
         public Rect toDevice(int startX, int startY, int sizeX, int sizeY, int rotate, Rect rect) {
             Point leftTop = toDevice(startX, startY, sizeX, sizeY, rotate, rect.left, rect.top);
             Point rightBottom = toDevice(startX, startY, sizeX, sizeY, rotate, rect.right, rect.bottom);
@@ -106,6 +359,171 @@ public class Pdfium {
 
         public native Point toPage(int startX, int startY, int sizeX, int sizeY, int rotate, int deviceX, int deviceY);
 
+        /**
+         * Close page, waits for running link lookups ({@link #getLinkAt(float, float, float)},
+         * {@link #getWebLinks()}) started from other threads.
+         */
+        public native void close();
+    }
+
+    /**
+     * Cancellation token for progressive operations. Can be cancelled from any thread.
+     */
+    public static class Cancel {
+        private volatile boolean cancelled;
+
+        public void cancel() {
+            cancelled = true;
+        }
+
+        public boolean isCancelled() {
+            return cancelled;
+        }
+    }
+
+    static float[] toMatrix(Matrix matrix) {
+        float[] v = new float[9];
+        matrix.getValues(v);
+        return new float[]{v[Matrix.MSCALE_X], v[Matrix.MSKEW_Y], v[Matrix.MSKEW_X], v[Matrix.MSCALE_Y], v[Matrix.MTRANS_X], v[Matrix.MTRANS_Y]};
+    }
+
+    /**
+     * Memory mapped full text search index created by {@link Pdfium#buildIndex(FileDescriptor, long)}. Words are
+     * lower cased, CJK ideographs indexed as single char words. Queries do not load pages and do not take library
+     * lock.
+     */
+    public static class Index {
+        private long handle;
+
+        /**
+         * Map index file, fd can be closed after constructor returns.
+         */
+        public Index(FileDescriptor fd) throws IOException {
+            open(fd);
+        }
+
+        native void open(FileDescriptor fd) throws IOException;
+
+        public native long getStamp();
+
+        public native int getPageCount();
+
+        /**
+         * Find phrase: all query words in order, adjacent on page.
+         *
+         * @param flags {@link #INDEX_PREFIX} or 0
+         * @return 3 values per hit: page index, char index, char count (see {@link Text#getBounds(int, int)})
+         */
+        public native int[] find(String query, int flags);
+
+        /**
+         * Unmap index. Other methods throw {@link IllegalStateException} after close.
+         */
+        public native void close();
+    }
+
+    /**
+     * Batch render job, see {@link Pdfium#render(RenderJob...)}. Target is {@link #bitmap} (ARGB_8888 or RGB_565)
+     * or direct {@link #buffer} described by width, height, stride and format (FORMAT_*).
+     */
+    public static class RenderJob {
+        public static final int DONE = 1;
+        public static final int ERROR_PAGE = -1; // page can't be loaded, or has zero size when fitted (drawSize 0)
+        public static final int ERROR_TARGET = -2; // bitmap can't be locked or bad buffer geometry
+
+        public int page;
+        public Bitmap bitmap;
+        public ByteBuffer buffer;
+        public int width;
+        public int height;
+        public int stride;
+        public int format;
+        public int startX;
+        public int startY;
+        public int drawSizeX; // 0 - fit page into target keeping aspect ratio, centered
+        public int drawSizeY;
+        public int flags;
+        public int status; // DONE or ERROR_*, 0 if not rendered
+
+        public RenderJob(int page, Bitmap bitmap, int flags) {
+            this.page = page;
+            this.bitmap = bitmap;
+            this.flags = flags;
+        }
+
+        public RenderJob(int page, Bitmap bitmap, int startX, int startY, int drawSizeX, int drawSizeY, int flags) {
+            this(page, bitmap, flags);
+            this.startX = startX;
+            this.startY = startY;
+            this.drawSizeX = drawSizeX;
+            this.drawSizeY = drawSizeY;
+        }
+
+        public RenderJob(int page, ByteBuffer buffer, int width, int height, int stride, int format, int startX, int startY, int drawSizeX, int drawSizeY, int flags) {
+            this.page = page;
+            this.buffer = buffer;
+            this.width = width;
+            this.height = height;
+            this.stride = stride;
+            this.format = format;
+            this.startX = startX;
+            this.startY = startY;
+            this.drawSizeX = drawSizeX;
+            this.drawSizeY = drawSizeY;
+            this.flags = flags;
+        }
+    }
+
+    /**
+     * Availability provider for partially downloaded document. Data is available when it is inside current file size
+     * (file growing by appending) or inside ranges reported by {@link #addRange(long, long)}.
+     * <p>
+     * Call {@link #isDocAvail()} whenever new data arrives, fetch ranges from {@link #getHints()} until it returns
+     * {@link #PDF_DATA_AVAIL}, then open document using {@link Pdfium#open(Avail, String)}.
+     */
+    public static class Avail {
+        private long handle;
+
+        /**
+         * @param length final (full) file length
+         */
+        public Avail(FileDescriptor fd, long length) throws IOException {
+            open(fd, length);
+        }
+
+        native void open(FileDescriptor fd, long length) throws IOException;
+
+        /**
+         * Mark downloaded file range as available
+         */
+        public native void addRange(long offset, long size);
+
+        /**
+         * @return {@link #PDF_DATA_ERROR}, {@link #PDF_DATA_NOTAVAIL} or {@link #PDF_DATA_AVAIL}
+         */
+        public native int isDocAvail();
+
+        /**
+         * Check page availability, document must be opened first.
+         *
+         * @return {@link #PDF_DATA_ERROR}, {@link #PDF_DATA_NOTAVAIL} or {@link #PDF_DATA_AVAIL}
+         */
+        public native int isPageAvail(int page);
+
+        /**
+         * @return {@link #PDF_LINEARIZATION_UNKNOWN}, {@link #PDF_NOT_LINEARIZED} or {@link #PDF_LINEARIZED}
+         */
+        public native int isLinearized();
+
+        /**
+         * Ranges to fetch next as (offset, size) pairs, highest priority first. Collected by last
+         * {@link #isDocAvail()} / {@link #isPageAvail(int)} call, already available data excluded.
+         */
+        public native long[] getHints();
+
+        /**
+         * Release provider. Documents opened from it keep it alive until closed.
+         */
         public native void close();
     }
 
@@ -121,6 +539,69 @@ public class Pdfium {
         }
     }
 
+    /**
+     * Batch of outline siblings in packed form.
+     */
+    public static class Outline {
+        public long[] handles; // node handles, valid until document closed
+        public int[] info; // OUTLINE_STRIDE values per node: destination page (-1 if none), flags, title end
+        public String titles; // all titles concatenated
+        public boolean more; // more siblings follow, continue with getOutlineNext(last handle, max)
+
+        public Outline(long[] handles, int[] info, String titles, boolean more) {
+            this.handles = handles;
+            this.info = info;
+            this.titles = titles;
+            this.more = more;
+        }
+
+        public int size() {
+            return handles.length;
+        }
+
+        public String getTitle(int i) {
+            int start = i == 0 ? 0 : info[(i - 1) * OUTLINE_STRIDE + 2];
+            return titles.substring(start, info[i * OUTLINE_STRIDE + 2]);
+        }
+
+        public int getPage(int i) {
+            return info[i * OUTLINE_STRIDE];
+        }
+
+        public boolean hasChildren(int i) {
+            return (info[i * OUTLINE_STRIDE + 1] & OUTLINE_CHILDREN) != 0;
+        }
+    }
+
+    /**
+     * Document properties, see {@link #describe(FileDescriptor, String)}.
+     */
+    public static class Description {
+        public String[] meta; // values in META_KEYS order, null if not set
+        public int version; // 14 for 1.4, 15 for 1.5, ...
+        public int pages;
+        public long permissions; // FPDF_GetDocPermissions() bits, 0xFFFFFFFF (all) for unencrypted documents
+        public float width; // first page size in points
+        public float height;
+
+        public Description(String[] meta, int version, int pages, long permissions, float width, float height) {
+            this.meta = meta;
+            this.version = version;
+            this.pages = pages;
+            this.permissions = permissions;
+            this.width = width;
+            this.height = height;
+        }
+
+        public String getMeta(String key) {
+            for (int i = 0; i < META_KEYS.length; i++) {
+                if (META_KEYS[i].equals(key))
+                    return meta[i];
+            }
+            return null;
+        }
+    }
+
     public static class Link {
         public String uri;
         public int index;
@@ -135,6 +616,8 @@ public class Pdfium {
 
     public static class Text {
         private long handle;
+        private long cache; // native char box cache
+        private long page; // FPDF_PAGE text belongs to
 
         public native int getCount();
 
@@ -144,8 +627,71 @@ public class Pdfium {
 
         public native Rect[] getBounds(int start, int count);
 
+        /**
+         * Get text range rectangles as single array.
+         *
+         * @return 4 values per rect: left, top, right, bottom in page coordinates
+         */
+        public native float[] getBoundsPacked(int start, int count);
+
+        /**
+         * Get rectangles of many text ranges (search hits) in single call.
+         *
+         * @param ranges start, count pairs
+         * @return per range: rect count n, then n rects (left, top, right, bottom in page coordinates)
+         */
+        public float[] getBoundsPacked(int[] ranges) {
+            return getBoundsRanges(ranges);
+        }
+
+        /**
+         * Write text range rectangles into direct {@link ByteBuffer} as native order floats, as many as fit.
+         *
+         * @return rect count, grow buffer and repeat if it does not fit
+         * @see #getLinkBounds(ByteBuffer)
+         */
+        public int getBounds(int start, int count, ByteBuffer buffer) {
+            return getBoundsBuffer(start, count, buffer);
+        }
+
+        /**
+         * Find char at page point using native char box cache. Cache is built on first call (library lock taken
+         * once), later calls do not take library lock and are safe for UI thread.
+         *
+         * @param tolerance max distance in page units to char box
+         * @return char index or -1
+         */
+        public native int getCharIndex(float x, float y, float tolerance);
+
+        /**
+         * Get selection rectangles of char range from native char box cache (line height boxes merged per line),
+         * no library lock after cache is built.
+         *
+         * @return 4 values per line: left, top, right, bottom in page coordinates
+         */
+        public native float[] getLineBounds(int start, int count);
+
+        /**
+         * Select text between two device points in single call, no library lock after char box cache is built
+         * (see {@link #getCharIndex(float, float, float)}). Viewport is the same as for
+         * {@link Page#toDevice(int, int, int, int, int, Rect)}. Points outside text snap to nearest char.
+         *
+         * @param flags {@link #SELECT_WORD}, {@link #SELECT_LINE} or 0
+         * @return start char index, char count, then line highlight rects in device coordinates (left, top,
+         * right, bottom). null if page has no text
+         */
+        public native float[] select(int startX, int startY, int sizeX, int sizeY, int rotate, float x1, float y1, float x2, float y2, int flags);
+
+        native float[] getBoundsRanges(int[] ranges);
+
+        native int getBoundsBuffer(int start, int count, ByteBuffer buffer);
+
         public native Search search(String str, int flags, int index);
 
+        /**
+         * Close text page, waits for running char cache queries ({@link #getCharIndex(float, float, float)},
+         * {@link #getLineBounds(int, int)}, select) started from other threads.
+         */
         public native void close();
     }
 
@@ -237,7 +783,118 @@ public class Pdfium {
     /**
      * Create new document from file with password
      */
-    public native void open(FileDescriptor fd, String password);
+    public void open(FileDescriptor fd, String password) {
+        open(fd, password, 0);
+    }
+
+    /**
+     * Create new document from file with password and open flags. With {@link #OPEN_MMAP} non mappable descriptors
+     * (pipes, some content providers) fall back to pread. Mapped file must not be truncated while document is open.
+     *
+     * @param flags 0 or combination of {@link #OPEN_MMAP}, {@link #OPEN_CACHE} (used when mapping is not possible)
+     */
+    public native void open(FileDescriptor fd, String password, int flags);
+
+    /**
+     * Render many pages / tiles holding library lock once. Pages are opened and closed natively, consecutive jobs
+     * for the same page share single page load. Result of each job is stored in {@link RenderJob#status}.
+     *
+     * @return number of rendered jobs
+     */
+    public int render(RenderJob... jobs) {
+        return renderJobs(jobs);
+    }
+
+    native int renderJobs(RenderJob[] jobs);
+
+    /**
+     * Extract text of page range and write it into file descriptor (at current position). Pages are loaded natively,
+     * library lock is held for one page at a time and released while writing.
+     *
+     * @param flags {@link #TEXT_UTF16} or {@link #TEXT_UTF8}
+     * @return count + 1 byte offsets relative to start position: offsets[i] start of page first + i, last one
+     * is the end of text
+     * @throws IllegalArgumentException if range is outside of document pages
+     */
+    public native long[] extractText(FileDescriptor fd, int first, int count, int flags) throws IOException;
+
+    /**
+     * Extract text of page range into direct {@link ByteBuffer} starting from buffer address (position ignored).
+     * Pages are never split: extraction stops on first page that does not fit, so caller can grow buffer and
+     * continue from page first + offsets.length - 1.
+     *
+     * @return n + 1 byte offsets for n extracted pages, see {@link #extractText(FileDescriptor, int, int, int)}
+     */
+    public long[] extractText(ByteBuffer buffer, int first, int count, int flags) throws IOException {
+        return extractTextBuffer(buffer, first, count, flags);
+    }
+
+    native long[] extractTextBuffer(ByteBuffer buffer, int first, int count, int flags) throws IOException;
+
+    /**
+     * Start document wide search from page first.
+     *
+     * @param flags {@link #FPDF_MATCHCASE}, {@link #FPDF_MATCHWHOLEWORD}
+     */
+    public Finder find(String query, int flags, int first) {
+        return new Finder(query, flags, first);
+    }
+
+    /**
+     * Build full text search index of whole document and write it into file descriptor. Index file must start at
+     * offset 0 (own sidecar file), see {@link Index}. Library lock is held for one page at a time.
+     *
+     * @param stamp document identity (file size, modification time), returned by {@link Index#getStamp()} to
+     *              detect stale index
+     */
+    public native void buildIndex(FileDescriptor fd, long stamp) throws IOException;
+
+    /**
+     * Render page range into single atlas bitmap laid out on cellWidth x cellHeight grid, row by row. Each page is
+     * fitted into its cell and centered. Library lock and bitmap pixels are locked once for whole sheet.
+     *
+     * @return page rectangles in atlas pixels, 4 values per page: left, top, right, bottom. Only pages which fit the
+     * grid are rendered and reported (at most columns * rows), zeros for pages failed to load or having zero size
+     */
+    public native int[] renderAtlas(Bitmap atlas, int first, int count, int cellWidth, int cellHeight, int flags);
+
+    /**
+     * Render page range into single atlas direct {@link ByteBuffer}.
+     *
+     * @see #renderAtlas(Bitmap, int, int, int, int, int)
+     */
+    public int[] renderAtlas(ByteBuffer buffer, int width, int height, int stride, int format, int first, int count, int cellWidth, int cellHeight, int flags) {
+        return renderAtlasBuffer(buffer, width, height, stride, format, first, count, cellWidth, cellHeight, flags);
+    }
+
+    native int[] renderAtlasBuffer(ByteBuffer buffer, int width, int height, int stride, int format, int first, int count, int cellWidth, int cellHeight, int flags);
+
+    /**
+     * Open partially downloaded document, first page of linearized document can be rendered before download completes.
+     * Check {@link Avail#isPageAvail(int)} before opening pages.
+     */
+    public void open(Avail avail, String password) throws IOException {
+        openAvail(avail, password);
+    }
+
+    native void openAvail(Avail avail, String password) throws IOException;
+
+    /**
+     * First available page of linearized document (usually 0), 0 for non linearized documents.
+     */
+    public native int getFirstAvailPage();
+
+    /**
+     * Set block cache memory budget in bytes for documents opened with {@link #OPEN_CACHE}. Default 1MB.
+     */
+    public native void setCacheSize(long bytes);
+
+    /**
+     * Block cache counters for documents opened with {@link #OPEN_CACHE}: hits, misses, bytes read, read calls.
+     *
+     * @return counters or null if document is not cached
+     */
+    public native long[] getCacheStats();
 
     /**
      * Get total numer of pages in document
@@ -246,6 +903,17 @@ public class Pdfium {
 
     public native Size getPageSize(int pageIndex);
 
+    /**
+     * Get geometry for pages range as packed array of {@link #PAGEINFO_STRIDE} floats per page:
+     * width, height (in points, rotation applied), rotation (0-3, -1 if not loaded), bounding box left, bottom,
+     * right, top (NaN if not loaded). Table is built lazily and cached: sizes by windows, boxes page by page with
+     * library lock released between page loads. Cached ranges are returned without waiting for library lock. Safe to call concurrently with {@link #close()}: zeros are returned for closed
+     * document.
+     *
+     * @param flags 0 or {@link #PAGEINFO_BOXES}
+     */
+    public native float[] getPageInfo(int first, int count, int flags);
+
     /**
      * Open page
      */
@@ -266,6 +934,80 @@ public class Pdfium {
      */
     public native Bookmark[] getTOC();
 
+    /**
+     * Get first children of outline node without walking whole outline. Malformed outlines with loops are cut at
+     * first repeated node.
+     *
+     * @param parent node handle from previous batch, 0 for top level
+     * @param max    maximum nodes returned, at least 1
+     * @throws IllegalArgumentException if max is less than 1
+     */
+    public Outline getOutline(long parent, int max) {
+        return getOutlineBatch(parent, 0, max);
+    }
+
+    /**
+     * Get next siblings of outline node.
+     *
+     * @param after last handle of previous batch
+     */
+    public Outline getOutlineNext(long after, int max) {
+        return getOutlineBatch(0, after, max);
+    }
+
+    native Outline getOutlineBatch(long parent, long after, int max);
+
+    /**
+     * Get outline entries containing page, outermost first. Entry section spans from its page up to the page of
+     * next entry on same or upper level. Index is built on first call (or by {@link #getTOC()}).
+     */
+    public Outline getSections(int page) {
+        return getSectionsPage(page);
+    }
+
+    /**
+     * Get innermost section of every page in range in single call. Range is clamped to document pages.
+     *
+     * @return per page: entry index in {@link #getTOC()} order, -1 if page is outside of any section
+     * @throws IllegalArgumentException if first or count is negative
+     */
+    public int[] getSections(int first, int count) {
+        return getSectionsRange(first, count);
+    }
+
+    native Outline getSectionsPage(int page);
+
+    native int[] getSectionsRange(int first, int count);
+
+    /**
+     * Get page label ("xii", "A-12"), null if page has no label. Label is resolved without loading pages and
+     * cached, other pages labels are not read.
+     */
+    public native String getPageLabel(int page);
+
+    /**
+     * Get labels of all pages, null entries for pages without label. Resolves every page label once per document,
+     * time grows quadratically with length of label ranges (library lock is released between pages), prefer
+     * {@link #getPageLabel(int)} for visible pages.
+     */
+    public native String[] getPageLabels();
+
+    /**
+     * Find page by label. Pages labels are resolved in order up to the first match and remembered, so first
+     * lookups cost like {@link #getPageLabels()} up to found page (whole document if label is missing), later
+     * lookups are hash map hits. Library lock is released between pages.
+     *
+     * @return first page with given label, -1 if none
+     */
+    public native int findPageLabel(String label);
+
+    /**
+     * Resolve named destination. Names are loaded into hash map on first call.
+     *
+     * @return {@link #DEST_STRIDE} values: page index, x, y, zoom (NaN if not set), null if name not found
+     */
+    public native float[] getNamedDest(String name);
+
     /**
      * The PDF file version. File version: 14 for 1.4, 15 for 1.5, ...
      */
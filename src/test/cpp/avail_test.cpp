@@ -0,0 +1,226 @@
+
+// Host test of partial download availability: file growth, sparse ranges and download hints. Pdfium
+// availability checker is replaced by stand-in which requests scripted segments.
+//
+// usage: avail_test
+
+#include "avail.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define LENGTH 100000 // full file length
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+// pdfium stand-in
+
+struct FAKEAVAIL {
+    FX_FILEAVAIL *fileAvail;
+    FPDF_FILEACCESS *file;
+};
+
+static std::vector<RANGE> sNeed; // segments next check asks for, in priority order
+static int sLastPage = -1;
+
+static int check(FPDF_AVAIL avail, FX_DOWNLOADHINTS *hints) {
+    FAKEAVAIL *fake = (FAKEAVAIL *) avail;
+    int result = PDF_DATA_AVAIL;
+    for (size_t i = 0; i < sNeed.size(); i++) {
+        if (!fake->fileAvail->IsDataAvail(fake->fileAvail, sNeed[i].first, sNeed[i].second)) {
+            hints->AddSegment(hints, sNeed[i].first, sNeed[i].second);
+            result = PDF_DATA_NOTAVAIL;
+        }
+    }
+    return result;
+}
+
+FPDF_AVAIL FPDFAvail_Create(FX_FILEAVAIL *file_avail, FPDF_FILEACCESS *file) {
+    FAKEAVAIL *fake = new FAKEAVAIL;
+    fake->fileAvail = file_avail;
+    fake->file = file;
+    return fake;
+}
+
+void FPDFAvail_Destroy(FPDF_AVAIL avail) {
+    delete (FAKEAVAIL *) avail;
+}
+
+int FPDFAvail_IsDocAvail(FPDF_AVAIL avail, FX_DOWNLOADHINTS *hints) {
+    return check(avail, hints);
+}
+
+int FPDFAvail_IsPageAvail(FPDF_AVAIL avail, int page_index, FX_DOWNLOADHINTS *hints) {
+    sLastPage = page_index;
+    return check(avail, hints);
+}
+
+// test file
+
+static uint8_t pattern(size_t position) {
+    return (uint8_t) (position * 13 + 5);
+}
+
+// append bytes up to size
+static bool grow(int fd, size_t size) {
+    off_t end = lseek(fd, 0, SEEK_END);
+    if (end < 0)
+        return false;
+    std::vector<uint8_t> data(size - end);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = pattern(end + i);
+    return write(fd, data.data(), data.size()) == (ssize_t) data.size();
+}
+
+static int tmpFile() {
+    char path[] = "/tmp/avail_testXXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0)
+        unlink(path);
+    return fd;
+}
+
+static bool sameHints(const std::vector<RANGE> &hints, const RANGE *expect, size_t n) {
+    if (hints.size() != n) {
+        for (size_t i = 0; i < hints.size(); i++)
+            fprintf(stderr, "hint %zu: %zu+%zu\n", i, hints[i].first, hints[i].second);
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (hints[i] != expect[i])
+            return false;
+    }
+    return true;
+}
+
+static void testGrowth() {
+    int fd = tmpFile();
+    CHECK(fd >= 0);
+    CHECK(grow(fd, 1000));
+    DataAvail avail(fd, LENGTH);
+    CHECK(avail.isAvail(0, 1000));
+    CHECK(!avail.isAvail(0, 1001));
+    CHECK(!avail.isAvail(5000, 10));
+
+    // appended data becomes available without addRange
+    CHECK(grow(fd, 6000));
+    CHECK(avail.isAvail(0, 6000));
+    CHECK(avail.isAvail(5000, 10));
+    CHECK(!avail.isAvail(5990, 20));
+
+    // nothing past declared length, even if file grows beyond it
+    CHECK(!avail.isAvail(LENGTH - 10, 20));
+    CHECK(grow(fd, LENGTH + 100));
+    CHECK(avail.isAvail(LENGTH - 10, 10));
+    CHECK(!avail.isAvail(LENGTH - 10, 20));
+
+    // pdfium reads through file access
+    FAKEAVAIL *fake = (FAKEAVAIL *) avail.avail;
+    uint8_t buf[100];
+    CHECK(fake->file->m_FileLen == LENGTH);
+    CHECK(fake->file->m_GetBlock(fake->file->m_Param, 4950, buf, sizeof(buf)));
+    bool same = true;
+    for (size_t i = 0; i < sizeof(buf); i++)
+        same = same && buf[i] == pattern(4950 + i);
+    CHECK(same);
+    close(fd);
+}
+
+static void testRanges() {
+    int fd = tmpFile();
+    CHECK(fd >= 0);
+    CHECK(grow(fd, 1000));
+    DataAvail avail(fd, LENGTH);
+
+    avail.addRange(10000, 1000);
+    avail.addRange(12000, 1000);
+    CHECK(avail.isAvail(10000, 1000));
+    CHECK(avail.isAvail(12000, 1000));
+    CHECK(!avail.isAvail(10500, 1000)); // gap 11000..12000
+    CHECK(!avail.isAvail(9999, 2));
+
+    // filling gap merges both neighbours
+    avail.addRange(11000, 1000);
+    CHECK(avail.isAvail(10000, 3000));
+    CHECK(!avail.isAvail(10000, 3001));
+
+    // contained range changes nothing
+    avail.addRange(10500, 100);
+    CHECK(avail.isAvail(10000, 3000));
+    CHECK(!avail.isAvail(9999, 2));
+
+    // overlapping range extends both ends
+    avail.addRange(9000, 5000);
+    CHECK(avail.isAvail(9000, 5000));
+    CHECK(!avail.isAvail(8999, 2));
+    CHECK(!avail.isAvail(13999, 2));
+
+    // range swallowing several ranges
+    avail.addRange(20000, 100);
+    avail.addRange(20200, 100);
+    avail.addRange(19000, 2000);
+    CHECK(avail.isAvail(19000, 2000));
+    CHECK(!avail.isAvail(18999, 2));
+    CHECK(!avail.isAvail(20999, 2));
+    CHECK(avail.isAvail(9000, 5000));
+    close(fd);
+}
+
+static void testHints() {
+    int fd = tmpFile();
+    CHECK(fd >= 0);
+    CHECK(grow(fd, 5000));
+    DataAvail avail(fd, LENGTH);
+    avail.addRange(22000, 1000);
+
+    sNeed.clear();
+    sNeed.push_back(RANGE(20000, 2000));
+    sNeed.push_back(RANGE(21000, 3000)); // overlaps previous, 22000..23000 downloaded
+    sNeed.push_back(RANGE(3000, 4000)); // head already in file
+    sNeed.push_back(RANGE(60000, 1000));
+    sNeed.push_back(RANGE(99500, 1000)); // runs past end of file
+    sNeed.push_back(RANGE(6000, 500)); // inside earlier hint
+    sNeed.push_back(RANGE(7000, 1000)); // touches earlier hint
+    CHECK(avail.isDocAvail() == PDF_DATA_NOTAVAIL);
+    RANGE expect[] = {RANGE(20000, 2000), RANGE(23000, 1000), RANGE(5000, 3000),
+                      RANGE(60000, 1000), RANGE(99500, 500)};
+    CHECK(sameHints(avail.getHints(), expect, sizeof(expect) / sizeof(expect[0])));
+
+    // hints are recomputed against data arrived since the check
+    avail.addRange(20000, 2000);
+    CHECK(grow(fd, 6000));
+    RANGE expect2[] = {RANGE(23000, 1000), RANGE(6000, 2000), RANGE(60000, 1000), RANGE(99500, 500)};
+    CHECK(sameHints(avail.getHints(), expect2, sizeof(expect2) / sizeof(expect2[0])));
+
+    // page check replaces pending hints
+    sNeed.clear();
+    sNeed.push_back(RANGE(40000, 100));
+    CHECK(avail.isPageAvail(3) == PDF_DATA_NOTAVAIL);
+    CHECK(sLastPage == 3);
+    RANGE expect3[] = {RANGE(40000, 100)};
+    CHECK(sameHints(avail.getHints(), expect3, 1));
+
+    // whole file arrived
+    CHECK(grow(fd, LENGTH));
+    CHECK(avail.getHints().empty());
+    CHECK(avail.isPageAvail(3) == PDF_DATA_AVAIL);
+    CHECK(avail.getHints().empty());
+    close(fd);
+}
+
+int main() {
+    testGrowth();
+    testRanges();
+    testHints();
+    if (failures != 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("avail_test passed\n");
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Host benchmark of pixel converters: convert_bench [width height iterations]
+// Checks that dispatched RGB565 kernel matches scalar rowTo565() and prints megapixels per second.
+
+#include "convert.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double seconds, int width, int height, int iterations) {
+    double mp = (double) width * height * iterations / 1e6;
+    printf("%-22s %8.1f MP/s\n", name, mp / seconds);
+}
+
+int main(int argc, char **argv) {
+    int width = argc > 2 ? atoi(argv[1]) : 1003; // odd width exercises kernel tails
+    int height = argc > 2 ? atoi(argv[2]) : 517;
+    int iterations = argc > 3 ? atoi(argv[3]) : 50;
+    if (width <= 0 || height <= 0 || iterations <= 0) {
+        fprintf(stderr, "usage: %s [width height [iterations]]\n", argv[0]);
+        return 2;
+    }
+
+    int rgbStride = width * 3;
+    std::vector<uint8_t> rgb(rgbStride * height);
+    srand(1);
+    for (size_t i = 0; i < rgb.size(); i++)
+        rgb[i] = rand() & 0xff;
+    std::vector<uint16_t> scalar(width * height), fast(width * height);
+    std::vector<uint8_t> out(width * height * 4);
+
+    for (int d = 0; d < 2; d++) { // kernels must be bit exact with scalar formula
+        for (int y = 0; y < height; y++)
+            rowTo565(&rgb[y * rgbStride], &scalar[y * width], width, y, d != 0);
+        rgbTo565(rgb.data(), rgbStride, fast.data(), width * 2, width, height, 0, 0, d != 0);
+        if (memcmp(scalar.data(), fast.data(), scalar.size() * 2) != 0) {
+            fprintf(stderr, "rgbTo565 (dither %d) differs from scalar kernel\n", d);
+            return 1;
+        }
+    }
+    for (int x = 1; x < 4 && x < width; x++) { // clipped conversion keeps dither pattern of whole image
+        rgbTo565(&rgb[x * 3], rgbStride, &fast[x], width * 2, width - x, height, x, 0, true);
+        if (memcmp(scalar.data(), fast.data(), scalar.size() * 2) != 0) {
+            fprintf(stderr, "rgbTo565 (dither, x %d) differs from scalar kernel\n", x);
+            return 1;
+        }
+    }
+
+    double t = now();
+    for (int i = 0; i < iterations; i++) {
+        for (int y = 0; y < height; y++)
+            rowTo565(&rgb[y * rgbStride], &scalar[y * width], width, y, false);
+    }
+    report("rowTo565 (scalar)", now() - t, width, height, iterations);
+
+    t = now();
+    for (int i = 0; i < iterations; i++)
+        rgbTo565(rgb.data(), rgbStride, fast.data(), width * 2, width, height, 0, 0, false);
+    report("rgbTo565", now() - t, width, height, iterations);
+
+    t = now();
+    for (int i = 0; i < iterations; i++)
+        rgbTo565(rgb.data(), rgbStride, fast.data(), width * 2, width, height, 0, 0, true);
+    report("rgbTo565 (dither)", now() - t, width, height, iterations);
+
+    t = now();
+    for (int i = 0; i < iterations; i++)
+        rgbToGray(rgb.data(), rgbStride, out.data(), width, width, height);
+    report("rgbToGray", now() - t, width, height, iterations);
+
+    t = now();
+    for (int i = 0; i < iterations; i++)
+        rgbTo888(rgb.data(), rgbStride, out.data(), width * 4, width, height, 4, false);
+    report("rgbTo888 (RGBA)", now() - t, width, height, iterations);
+
+    t = now();
+    for (int i = 0; i < iterations; i++)
+        scaleToRgb(rgb.data(), width, height, rgbStride, 3, out.data(), width * 3, width, height, 0,
+                   height);
+    report("scaleToRgb", now() - t, width, height, iterations);
+    return 0;
+}
@@ -0,0 +1,146 @@
+// Host test of sidecar text index: build, write, map and query.
+//
+// usage: index_test
+
+#include "index.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static std::vector<uint16_t> utf16(const char *s) {
+    std::vector<uint16_t> v;
+    for (; *s; s++)
+        v.push_back((unsigned char) *s);
+    return v;
+}
+
+static void add(IndexBuilder &builder, int page, const char *text) {
+    std::vector<uint16_t> t = utf16(text);
+    builder.add(page, t.data(), t.size());
+}
+
+static std::vector<INDEXHIT> find(TextIndex &index, const char *query, int flags) {
+    std::vector<uint16_t> q = utf16(query);
+    return index.find(q.data(), q.size(), flags);
+}
+
+static int tmpFile() {
+    char path[] = "/tmp/index_testXXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0)
+        unlink(path);
+    return fd;
+}
+
+static void testTokenize() {
+    std::vector<TERM> words;
+    std::vector<uint32_t> index;
+    std::vector<uint16_t> t = utf16("  Hello, World-42!");
+    tokenize(t.data(), t.size(), words, index);
+    CHECK(words.size() == 3);
+    if (words.size() == 3) {
+        CHECK(words[0] == utf16("hello"));
+        CHECK(words[1] == utf16("world"));
+        CHECK(words[2] == utf16("42"));
+        CHECK(index[0] == 2 && index[1] == 9 && index[2] == 15);
+    }
+
+    words.clear();
+    index.clear();
+    const uint16_t cjk[] = {0x65E5, 0x672C, ' ', 'a', 0xD840, 0xDC00}; // two ideographs, word, surrogate pair
+    tokenize(cjk, 6, words, index);
+    CHECK(words.size() == 4);
+    if (words.size() == 4)
+        CHECK(index[0] == 0 && index[1] == 1 && index[2] == 3 && index[3] == 4);
+}
+
+static void testQuery() {
+    IndexBuilder builder;
+    add(builder, 0, "The quick brown fox");
+    add(builder, 2, "jumps over the lazy dog. The quick fox!");
+    int fd = tmpFile();
+    CHECK(fd >= 0);
+    CHECK(builder.write(fd, 0x1234567890ULL));
+
+    TextIndex index;
+    CHECK(index.open(fd));
+    close(fd); // mapping outlives descriptor
+    CHECK(index.getStamp() == 0x1234567890ULL);
+    CHECK(index.getPageCount() == 3);
+
+    std::vector<INDEXHIT> hits = find(index, "QUICK", 0);
+    CHECK(hits.size() == 2);
+    if (hits.size() == 2) {
+        CHECK(hits[0].page == 0 && hits[0].index == 4 && hits[0].count == 5);
+        CHECK(hits[1].page == 2 && hits[1].index == 29 && hits[1].count == 5);
+    }
+
+    hits = find(index, "quick fox", 0); // phrase, adjacent words only
+    CHECK(hits.size() == 1);
+    if (hits.size() == 1)
+        CHECK(hits[0].page == 2 && hits[0].index == 29 && hits[0].count == 9);
+
+    hits = find(index, "the qu", INDEX_PREFIX);
+    CHECK(hits.size() == 2);
+
+    CHECK(find(index, "the qu", 0).empty());
+    CHECK(find(index, "cat", 0).empty());
+    CHECK(find(index, " ,. ", 0).empty());
+}
+
+static void testBadFile() {
+    int fd = tmpFile();
+    CHECK(fd >= 0);
+    TextIndex empty;
+    CHECK(!empty.open(fd)); // too short
+
+    INDEXHEADER h;
+    memset(&h, 0, sizeof(h));
+    h.magic = INDEX_MAGIC;
+    h.version = INDEX_VERSION;
+    h.terms = 1000; // sections past end of file
+    CHECK(write(fd, &h, sizeof(h)) == sizeof(h));
+    TextIndex truncated;
+    CHECK(!truncated.open(fd));
+    close(fd);
+
+    for (int bad = 0; bad < 2; bad++) { // consistent size, term pointing past chars / postings
+        fd = tmpFile();
+        CHECK(fd >= 0);
+        h.terms = 1;
+        h.chars = 2;
+        h.postings = 1;
+        INDEXTERM t = {0, 2, 0, 1};
+        if (bad == 0)
+            t.text = 1;
+        else
+            t.count = 2;
+        uint16_t chars[2] = {'a', 'b'};
+        INDEXPOSTING p = {0, 0, 0};
+        CHECK(write(fd, &h, sizeof(h)) == sizeof(h));
+        CHECK(write(fd, &t, sizeof(t)) == sizeof(t));
+        CHECK(write(fd, chars, sizeof(chars)) == sizeof(chars));
+        CHECK(write(fd, &p, sizeof(p)) == sizeof(p));
+        TextIndex corrupt;
+        CHECK(!corrupt.open(fd));
+        close(fd);
+    }
+}
+
+int main() {
+    testTokenize();
+    testQuery();
+    testBadFile();
+    if (failures != 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("index_test passed\n");
+    return 0;
+}
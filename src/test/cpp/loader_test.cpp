@@ -0,0 +1,181 @@
+
+// Host test of file loader block cache and read-ahead over slow storage stand-in.
+//
+// usage: loader_test
+
+#include "loader.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <vector>
+
+#define BLOCKS 100 // full blocks in test file
+#define TAIL 1000 // bytes after last full block
+#define LATENCY 1000 // microseconds per slowRead call
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static std::vector<size_t> sReads; // sizes requested from slowRead
+
+// pread with seek latency of slow media
+static ssize_t slowRead(int fd, void *buf, size_t count, off_t offset) {
+    usleep(LATENCY);
+    sReads.push_back(count);
+    return pread(fd, buf, count, offset);
+}
+
+static uint8_t pattern(size_t position) {
+    return (uint8_t) (position * 7 + position / LOADER_BLOCK);
+}
+
+static int tmpFile() {
+    char path[] = "/tmp/loader_testXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return fd;
+    unlink(path);
+    std::vector<uint8_t> data(BLOCKS * LOADER_BLOCK + TAIL);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = pattern(i);
+    if (write(fd, data.data(), data.size()) != (ssize_t) data.size()) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static bool readAt(FileLoader &loader, size_t position, size_t size) {
+    std::vector<uint8_t> buf(size);
+    FPDF_FILEACCESS *access = loader.getAccess();
+    if (!access->m_GetBlock(access->m_Param, position, buf.data(), size))
+        return false;
+    for (size_t i = 0; i < size; i++) {
+        if (buf[i] != pattern(position + i))
+            return false;
+    }
+    return true;
+}
+
+// read whole file front to back in small chunks, as pdfium parser does
+static bool readAll(FileLoader &loader) {
+    size_t length = BLOCKS * LOADER_BLOCK + TAIL;
+    for (size_t position = 0; position < length; position += 4096) {
+        size_t size = length - position < 4096 ? length - position : 4096;
+        if (!readAt(loader, position, size))
+            return false;
+    }
+    return true;
+}
+
+static void testSequential(int fd) {
+    sReads.clear();
+    FileLoader loader(fd, BLOCKS * LOADER_BLOCK + TAIL, 4 * 1024 * 1024, &slowRead);
+    double start = now();
+    CHECK(readAll(loader));
+    double elapsed = now() - start;
+
+    // window doubles on every miss up to LOADER_READAHEAD, last read stops at end of file
+    size_t expect[] = {2, 4, 8, 16, 32, 32};
+    size_t n = sizeof(expect) / sizeof(expect[0]);
+    CHECK(sReads.size() == n + 1);
+    for (size_t i = 0; i < n && i < sReads.size(); i++)
+        CHECK(sReads[i] == expect[i] * LOADER_BLOCK);
+    if (sReads.size() == n + 1)
+        CHECK(sReads[n] == (BLOCKS - 94) * LOADER_BLOCK + TAIL);
+    CHECK(loader.misses == (long long) n + 1);
+    CHECK(loader.reads == (long long) n + 1);
+    CHECK(loader.hits == BLOCKS * (LOADER_BLOCK / 4096) + 1 - loader.misses);
+    CHECK(loader.bytesRead == BLOCKS * LOADER_BLOCK + TAIL);
+
+    // everything fits budget, second pass is served from cache
+    long long misses = loader.misses;
+    CHECK(readAll(loader));
+    CHECK(loader.misses == misses);
+
+    printf("sequential: %lld reads, %lld hits, %lld misses, %.1f ms\n", loader.reads, loader.hits,
+           loader.misses, elapsed);
+}
+
+static void testSeek(int fd) {
+    sReads.clear();
+    FileLoader loader(fd, BLOCKS * LOADER_BLOCK + TAIL, 4 * 1024 * 1024, &slowRead);
+    CHECK(readAt(loader, 10 * LOADER_BLOCK, 100)); // seek, single block
+    CHECK(readAt(loader, 11 * LOADER_BLOCK, 100)); // sequential, window 2
+    CHECK(readAt(loader, 12 * LOADER_BLOCK, 100)); // prefetched
+    CHECK(readAt(loader, 13 * LOADER_BLOCK, 100)); // sequential, window 4
+    CHECK(readAt(loader, 60 * LOADER_BLOCK, 100)); // seek resets window
+    CHECK(readAt(loader, 5 * LOADER_BLOCK, 100)); // backward seek
+    CHECK(readAt(loader, 6 * LOADER_BLOCK, 100)); // sequential again, window 2
+
+    size_t expect[] = {1, 2, 4, 1, 1, 2};
+    size_t n = sizeof(expect) / sizeof(expect[0]);
+    CHECK(sReads.size() == n);
+    for (size_t i = 0; i < n && i < sReads.size(); i++)
+        CHECK(sReads[i] == expect[i] * LOADER_BLOCK);
+    CHECK(loader.misses == (long long) n);
+    CHECK(loader.hits == 1);
+
+    // read spanning blocks 14..16 is served by window 4 prefetch from block 13
+    CHECK(readAt(loader, 14 * LOADER_BLOCK + 100, 2 * LOADER_BLOCK));
+    CHECK(loader.misses == (long long) n);
+    CHECK(loader.hits == 4);
+
+    // out of file range fails without reading
+    CHECK(!readAt(loader, BLOCKS * LOADER_BLOCK, TAIL + 1));
+    CHECK(sReads.size() == n);
+}
+
+static void testBudget(int fd) {
+    sReads.clear();
+    // budget of two blocks leaves no room for read-ahead, every block is its own read
+    FileLoader loader(fd, BLOCKS * LOADER_BLOCK + TAIL, 2 * LOADER_BLOCK, &slowRead);
+    double start = now();
+    CHECK(readAll(loader));
+    double elapsed = now() - start;
+    CHECK(loader.reads == BLOCKS + 1);
+    CHECK(loader.misses == BLOCKS + 1);
+
+    // first block was evicted
+    long long misses = loader.misses;
+    CHECK(readAt(loader, 0, 100));
+    CHECK(loader.misses == misses + 1);
+
+    // growing budget enables read-ahead again
+    loader.setBudget(4 * 1024 * 1024);
+    sReads.clear();
+    CHECK(readAt(loader, LOADER_BLOCK, 100));
+    CHECK(sReads.size() == 1 && sReads[0] == 2 * LOADER_BLOCK);
+
+    printf("no read-ahead: %lld reads, %lld hits, %lld misses, %.1f ms\n", loader.reads,
+           loader.hits, loader.misses, elapsed);
+}
+
+int main() {
+    int fd = tmpFile();
+    if (fd < 0) {
+        fprintf(stderr, "Cannot create test file\n");
+        return 1;
+    }
+    testSequential(fd);
+    testSeek(fd);
+    testBudget(fd);
+    close(fd);
+    if (failures != 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("loader_test passed\n");
+    return 0;
+}